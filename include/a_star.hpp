@@ -2,161 +2,235 @@
 #define A_STAR_HPP_
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <iomanip> // for std::setw
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <memory>
-#include <queue>
-#include <unordered_map>
 #include <vector>
 
+#include "heuristics.hpp"
+#include "occupancy_grid.hpp"
+#include "open_list.hpp"
+#include "point.hpp"
+#include "search_stats.hpp"
+#include "search_workspace.hpp"
+
 namespace astar {
 
-class Point {
+/// Every passable cell costs the same to enter.
+struct UniformCost {
+  float operator()(int32_t) const { return 1.0f; }
+};
+
+/** A* on an occupancy grid, 8-connected; a diagonal move only needs the target cell free.
+ *
+ * `Heuristic` estimates the remaining cost (see heuristics.hpp) and must be
+ * admissible and consistent for the returned paths to be optimal.
+ * `CostModel` maps the index of the cell being entered to a factor on the
+ * step cost; factors below 1 would make the geometric heuristics
+ * inadmissible, infinity forbids the cell. `Grid` is the map the search
+ * reads: an OccupancyGrid, or anything with its width(), height(),
+ * inBounds(), index(), isPassable() and passableNeighborhood(), such as a
+ * TiledGridView. `OpenList` is one of the open lists in open_list.hpp.
+ */
+template <typename Heuristic, typename CostModel = UniformCost, typename Grid = gridmap::OccupancyGrid,
+          typename OpenList = IndexedHeapOpenList<4>>
+class BasicAStar {
 public:
-  int x, y;
+  /// Plans on a private, initially free grid populated through setWall().
+  BasicAStar(int width, int height, const Point &start_, const Point &goal_, Heuristic heuristic_ = Heuristic(),
+             CostModel costModel_ = CostModel()) :
+    start(start_), goal(goal_),
+    ownedGrid(std::make_unique<Grid>(width, height)),
+    grid(ownedGrid.get()), heuristic(std::move(heuristic_)), costModel(std::move(costModel_)) {}
+
+  /// Plans directly on a shared grid; the grid must outlive the planner.
+  BasicAStar(const Grid &grid_, const Point &start_, const Point &goal_,
+             Heuristic heuristic_ = Heuristic(), CostModel costModel_ = CostModel()) :
+    start(start_), goal(goal_), grid(&grid_), heuristic(std::move(heuristic_)), costModel(std::move(costModel_)) {}
+
+  /// Only affects planners that own their grid.
+  void setWall(int x, int y) {
+    if (ownedGrid) {
+      ownedGrid->setValue(x, y, gridmap::OccupancyGrid::kOccupied);
+    }
+  }
 
-  Point(int x_ = 0, int y_ = 0) : x(x_), y(y_) {}
+  std::vector<Point> findPath() {
+    return findPath(workspace);
+  }
 
-  bool operator==(const Point &o) const {
-    return x == o.x && y == o.y;
+  std::vector<Point> findPath(SearchWorkspace &workspace_) const {
+    std::vector<Point> path;
+    findPath(start, goal, workspace_, path);
+    return path;
   }
 
-  bool operator!=(const Point &o) const {
-    return !(*this == o);
+  /** Searches from `from` to `to` using the caller-owned workspace.
+   *
+   * `path` is cleared and refilled in place, so a caller that keeps both the
+   * workspace and the path vector alive does not allocate on repeated queries.
+   * If `cancel` is given it is polled periodically and the search gives up
+   * once it is set. Returns false if no path exists or the search was cancelled.
+   */
+  bool findPath(const Point &from, const Point &to, SearchWorkspace &workspace_,
+                std::vector<Point> &path, const std::atomic<bool> *cancel = nullptr) const {
+    NoSearchHooks hooks;
+    return search(from, to, nullptr, workspace_, path, cancel, hooks);
   }
 
-  bool operator<(const Point &o) const {
-    return x < o.x || (x == o.x && y < o.y);
+  /// findPath() reporting to `hooks`, e.g. a SearchStatsHooks (see search_stats.hpp).
+  template <typename Hooks>
+  bool findPath(const Point &from, const Point &to, SearchWorkspace &workspace_, std::vector<Point> &path,
+                Hooks &hooks, const std::atomic<bool> *cancel = nullptr) const {
+    return search(from, to, nullptr, workspace_, path, cancel, hooks);
   }
-};
 
-} // namespace astar
+  /// Same as findPath(), but the search never leaves `bounds`.
+  bool findPathWithin(const gridmap::CellRect &bounds, const Point &from, const Point &to,
+                      SearchWorkspace &workspace_, std::vector<Point> &path,
+                      const std::atomic<bool> *cancel = nullptr) const {
+    path.clear();
+    if (!bounds.contains(from.x, from.y) || !bounds.contains(to.x, to.y)) return false;
+    NoSearchHooks hooks;
+    return search(from, to, &bounds, workspace_, path, cancel, hooks);
+  }
 
-namespace std {
-  template <>
-  struct hash<astar::Point> {
-    size_t operator()(const astar::Point &p) const {
-      return hash<long long>()((static_cast<long long>(p.x) << 32) | static_cast<unsigned>(p.y));
+  /** Uniform-cost flood from `from` that never leaves `bounds`.
+   *
+   * Afterwards every reached cell is closed in `workspace_` and its gCost is
+   * the cost of the cheapest path from `from` inside `bounds`, unless
+   * `cancel` stopped the flood early.
+   */
+  void floodWithin(const gridmap::CellRect &bounds, const Point &from, SearchWorkspace &workspace_,
+                   const std::atomic<bool> *cancel = nullptr) const {
+    std::vector<Point> unused;
+    if (!bounds.contains(from.x, from.y) || !isInBounds(from)) {
+      workspace_.prepare(grid->width(), grid->height());
+      return;
     }
-  };
-}
-
-namespace astar {
-
-class AStar {
-  struct Node {
-    Point coordinates;
-    Node *parent;
-    float gCost;
-    float hCost;
-
-    float fCost() const { return gCost + hCost; }
-
-    Node(Point coord_, Node *parent_ = nullptr) :
-      coordinates(coord_), parent(parent_), gCost(0), hCost(0) {}
-  };
-
-public:
-  AStar(int width, int height, const Point &start_, const Point &goal_) :
-    gridWidth(width), gridHeight(height), start(start_), goal(goal_) {
-    grid.resize(gridWidth, std::vector<bool>(gridHeight, true));
+    NoSearchHooks hooks;
+    search(from, Point(-1, -1), &bounds, workspace_, unused, cancel, hooks);
   }
 
-  void setWall(int x, int y) {
-    if (x >= 0 && x < gridWidth && y >= 0 && y < gridHeight) {
-      grid[x][y] = false;
-    }
+  bool isWalkable(int x, int y) const {
+    return grid->isPassable(x, y);
   }
 
-  struct CompareNode {
-    bool operator()(const Node *lhs, const Node *rhs) const {
-      if (lhs->fCost() == rhs->fCost())
-        return lhs->hCost > rhs->hCost; // Prefer closer to goal
-      return lhs->fCost() > rhs->fCost();
-    }
-  };
+  const Grid &occupancyGrid() const { return *grid; }
 
-  std::vector<Point> findPath() {
-    std::vector<Point> path;
-    std::priority_queue<Node *, std::vector<Node *>, CompareNode> openSet;
-    std::unordered_map<Point, std::unique_ptr<Node>> allNodes;
+  const Heuristic &heuristicFunction() const { return heuristic; }
 
-    auto startNode = std::make_unique<Node>(start);
-    startNode->gCost = 0;
-    startNode->hCost = heuristic(start, goal);
+private:
+  Point start, goal;
+  std::unique_ptr<Grid> ownedGrid;
+  const Grid *grid;
+  Heuristic heuristic;
+  CostModel costModel;
+  SearchWorkspace workspace;
 
-    openSet.push(startNode.get());
-    allNodes[start] = std::move(startNode);
+  const float diagonalCost = std::sqrt(2.0f);
+  const float straightCost = 1.0f;
 
-    while (!openSet.empty()) {
-      Node *currentNode = openSet.top();
-      openSet.pop();
+  template <typename Hooks>
+  bool search(const Point &from, const Point &to, const gridmap::CellRect *bounds,
+              SearchWorkspace &workspace_, std::vector<Point> &path,
+              const std::atomic<bool> *cancel, Hooks &hooks) const {
+    using State = SearchWorkspace::State;
+
+    // A goal outside the grid turns the search into a flood with h = 0.
+    const bool flood = !isInBounds(to);
+    path.clear();
+    if (!isInBounds(from) || (!flood && !isInBounds(to))) return false;
+
+    hooks.begin(workspace_);
+    const int gridWidth = grid->width();
+    workspace_.prepare(gridWidth, grid->height());
+    const int32_t startIndex = indexOf(from);
+    const int32_t goalIndex = flood ? -1 : indexOf(to);
+
+    OpenList open(workspace_);
+    workspace_.open(startIndex, 0.0f, -1);
+    const float startH = flood ? 0.0f : heuristic(from, to);
+    open.push(startH, startH, startIndex);
+    hooks.push(false, open.size());
+    hooks.phase(SearchPhase::kExpand);
+
+    while (!open.empty()) {
+      const SearchWorkspace::OpenEntry entry = open.pop();
+      SearchWorkspace::NodeRecord &current = workspace_.node(entry.index);
+      if (!OpenList::kDecreaseKey && current.state == State::kClosed) { // Stale duplicate entry
+        hooks.stalePop();
+        continue;
+      }
+      current.state = State::kClosed;
+      workspace_.countExpansion();
+      hooks.expand(entry.index);
+      if (cancelRequested(cancel, workspace_.expanded())) {
+        hooks.end(workspace_);
+        return false;
+      }
 
-      if (currentNode->coordinates == goal) {
-        while (currentNode != nullptr) {
-          path.push_back(currentNode->coordinates);
-          currentNode = currentNode->parent;
+      if (entry.index == goalIndex) {
+        hooks.phase(SearchPhase::kPath);
+        for (int32_t index = goalIndex; index != -1; index = workspace_.node(index).parent) {
+          path.emplace_back(index % gridWidth, index / gridWidth);
         }
-        break;
+        std::reverse(path.begin(), path.end());
+        hooks.end(workspace_);
+        return true;
       }
 
-      for (int x = -1; x <= 1; x++) {
-        for (int y = -1; y <= 1; y++) {
-          if (x == 0 && y == 0) continue;
-
-          Point newCoordinates(currentNode->coordinates.x + x, currentNode->coordinates.y + y);
-
-          if (!isInBounds(newCoordinates) || !grid[newCoordinates.x][newCoordinates.y]) continue;
-
-          float newGCost = currentNode->gCost + ((abs(x + y) == 1) ? straightCost : diagonalCost);
-
-          auto found = allNodes.find(newCoordinates);
-          if (found != allNodes.end() && found->second->gCost <= newGCost) continue;
-
-          auto successor = std::make_unique<Node>(newCoordinates, currentNode);
-          successor->gCost = newGCost;
-          successor->hCost = heuristic(successor->coordinates, goal);
-          Node* rawPtr = successor.get();
-
-          allNodes[newCoordinates] = std::move(successor);
-          // openSet.push(successor.get());
-          openSet.push(rawPtr);
-        }
+      const int cx = entry.index % gridWidth;
+      const int cy = entry.index / gridWidth;
+
+      // Bit (dy+1)*3 + (dx+1) of the mask is set for every passable neighbor.
+      unsigned neighbors = grid->passableNeighborhood(cx, cy) & ~(1u << 4);
+      while (neighbors != 0) {
+        const int bit = __builtin_ctz(neighbors);
+        neighbors &= neighbors - 1;
+
+        const int x = bit % 3 - 1;
+        const int y = bit / 3 - 1;
+        const int nx = cx + x;
+        const int ny = cy + y;
+        if (bounds != nullptr && !bounds->contains(nx, ny)) continue;
+
+        const int32_t neighborIndex = ny * gridWidth + nx;
+        const float factor = costModel(neighborIndex);
+        if (factor == std::numeric_limits<float>::infinity()) continue;
+        const float newGCost = current.gCost + ((x == 0 || y == 0) ? straightCost : diagonalCost) * factor;
+
+        const State state = workspace_.state(neighborIndex);
+        if (state == State::kClosed) continue;
+        if (state == State::kOpen && workspace_.node(neighborIndex).gCost <= newGCost) continue;
+
+        workspace_.open(neighborIndex, newGCost, entry.index);
+        const float hCost = flood ? 0.0f : heuristic(Point(nx, ny), to);
+        open.push(newGCost + hCost, hCost, neighborIndex);
+        hooks.push(state == State::kOpen, open.size());
       }
     }
 
-    std::reverse(path.begin(), path.end());
-    return path;
-  }
-
-  bool isWalkable(int x, int y) const {
-    if (x >= 0 && x < gridWidth && y >= 0 && y < gridHeight) {
-      return grid[x][y];
-    }
+    hooks.end(workspace_);
     return false;
   }
 
-private:
-  Point start, goal;
-  std::vector<std::vector<bool>> grid;
-  int gridWidth, gridHeight;
-
-  const float diagonalCost = std::sqrt(2.0f);
-  const float straightCost = 1.0f;
-
-  static float heuristic(const Point &a, const Point &b) {
-    float dx = static_cast<float>(a.x - b.x);
-    float dy = static_cast<float>(a.y - b.y);
-    float dist = std::sqrt(dx * dx + dy * dy);
-    return dist;
+  bool isInBounds(const Point &p) const {
+    return grid->inBounds(p.x, p.y);
   }
 
-  bool isInBounds(const Point &p) const {
-    return p.x >= 0 && p.x < gridWidth && p.y >= 0 && p.y < gridHeight;
+  int32_t indexOf(const Point &p) const {
+    return static_cast<int32_t>(grid->index(p.x, p.y));
   }
 };
 
+/// Default planner: the octile distance is exact on open ground and needs no square root.
+using AStar = BasicAStar<OctileHeuristic>;
+
 } // namespace astar
 
 #endif // A_STAR_HPP_
\ No newline at end of file
@@ -0,0 +1,241 @@
+#ifndef ASYNC_PLANNER_HPP_
+#define ASYNC_PLANNER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "a_star.hpp"
+#include "grid_planner.hpp"
+#include "occupancy_grid.hpp"
+#include "path_smoothing.hpp"
+#include "planning_service.hpp"
+#include "search_stats.hpp"
+#include "search_workspace.hpp"
+#include "triple_buffer.hpp"
+
+namespace astar {
+
+struct PlanResult {
+  uint64_t requestId = 0;
+  PlanKey key;
+  std::vector<Point> path;
+  std::vector<PathPose> poses; // Drivable path of a lattice search, in cells; empty for the grid searches
+  bool cancelled = false;
+  size_t expanded = 0;
+  double milliseconds = 0.0;
+  SearchStats stats;
+  std::vector<int32_t> expandedCells; // In expansion order; only filled while recording is on
+  std::shared_ptr<const FlowField> flowField; // Field to the goal while setComputeFlowFields() is on; null if cancelled
+};
+
+/// Ticket for one submitted request.
+class PlanHandle {
+public:
+  PlanHandle() = default;
+
+  bool valid() const { return future.valid(); }
+  uint64_t id() const { return requestId; }
+
+  /// Asks the worker to drop the request; the future still completes, flagged as cancelled.
+  void cancel() {
+    if (cancelFlag) cancelFlag->store(true, std::memory_order_relaxed);
+  }
+
+  bool ready() const {
+    return future.valid() &&
+           future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
+  const PlanResult &get() const { return future.get(); }
+
+private:
+  friend class AsyncPlanner;
+
+  uint64_t requestId = 0;
+  std::shared_ptr<std::atomic<bool>> cancelFlag;
+  std::shared_future<PlanResult> future;
+};
+
+/** Runs grid searches on a background thread.
+ *
+ * Only the most recent request matters: submitting a new one cancels the
+ * request it supersedes, whether it is still queued or already searching.
+ * Finished paths are handed to the render thread through a triple buffer, so
+ * pollResult()/latest() never take a lock.
+ *
+ * The grid is read by the worker while a search runs; callers that modify it
+ * must call waitIdle() first.
+ *
+ * Every search reports to a SearchStatsHooks, whose counters and phase times
+ * come back in PlanResult::stats. With setRecordExpansions() the result also
+ * lists the expanded cells, e.g. for a heatmap, and with
+ * setComputeFlowFields() it carries the flow field to the goal, computed
+ * after the search under the same cancel flag.
+ */
+class AsyncPlanner {
+public:
+  /// `landmarkCache` is where the ALT landmark tables are cached, see GridPlanner.
+  explicit AsyncPlanner(const gridmap::OccupancyGrid &grid_, std::string landmarkCache = std::string()) :
+    grid(grid_), planner(grid_, std::move(landmarkCache)), worker([this]() { run(); }) {}
+
+  AsyncPlanner(const gridmap::OccupancyGrid &grid_, PlannerIndices indices) :
+    grid(grid_), planner(grid_, std::move(indices)), worker([this]() { run(); }) {}
+
+  ~AsyncPlanner() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+      if (pending) pending->cancelFlag->store(true, std::memory_order_relaxed);
+      if (running) running->store(true, std::memory_order_relaxed);
+    }
+    wakeup.notify_all();
+    worker.join();
+  }
+
+  AsyncPlanner(const AsyncPlanner &) = delete;
+  AsyncPlanner &operator=(const AsyncPlanner &) = delete;
+
+  /// Headings (radians, cell coordinates) are only planned for by Algorithm::kLattice.
+  PlanHandle submit(const Point &start, const Point &goal, Algorithm algorithm = Algorithm::kAStar,
+                    float startHeading = 0.0f, float goalHeading = 0.0f) {
+    auto job = std::make_unique<Job>();
+    job->result.requestId = ++lastRequestId;
+    job->result.key = PlanKey{start, goal, grid.version(), algorithm, startHeading, goalHeading};
+    job->cancelFlag = std::make_shared<std::atomic<bool>>(false);
+
+    PlanHandle handle;
+    handle.requestId = job->result.requestId;
+    handle.cancelFlag = job->cancelFlag;
+    handle.future = job->promise.get_future().share();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (pending) {
+        pending->cancelFlag->store(true, std::memory_order_relaxed);
+        finishCancelled(*pending);
+      }
+      if (running) running->store(true, std::memory_order_relaxed);
+      pending = std::move(job);
+    }
+    wakeup.notify_one();
+    return handle;
+  }
+
+  /// Render thread: adopts the newest finished result, if any. Lock-free.
+  bool pollResult() { return results.update(); }
+
+  /// Render thread: last result adopted by pollResult().
+  const PlanResult &latest() const { return results.front(); }
+
+  /// Cancels queued and running work and blocks until the worker is idle.
+  void waitIdle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (pending) {
+      pending->cancelFlag->store(true, std::memory_order_relaxed);
+      finishCancelled(*pending);
+      pending.reset();
+    }
+    if (running) running->store(true, std::memory_order_relaxed);
+    idle.wait(lock, [this]() { return !running; });
+  }
+
+  /// Applies from the next search on.
+  void setRecordExpansions(bool record) { recordExpansions.store(record, std::memory_order_relaxed); }
+
+  /// Applies from the next search on.
+  void setComputeFlowFields(bool compute) { computeFlowFields.store(compute, std::memory_order_relaxed); }
+
+  bool busy() const { return searching.load(std::memory_order_relaxed); }
+  uint64_t invocations() const { return invocationCount.load(std::memory_order_relaxed); }
+
+private:
+  struct Job {
+    PlanResult result;
+    std::shared_ptr<std::atomic<bool>> cancelFlag;
+    std::promise<PlanResult> promise;
+  };
+
+  const gridmap::OccupancyGrid &grid;
+  GridPlanner planner;
+  SearchWorkspace workspace;
+  SearchStatsHooks hooks;
+  TripleBuffer<PlanResult> results;
+
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  std::condition_variable idle;
+  std::unique_ptr<Job> pending;
+  std::shared_ptr<std::atomic<bool>> running;
+  bool stopping = false;
+  uint64_t lastRequestId = 0;
+  std::atomic<bool> searching{false};
+  std::atomic<bool> recordExpansions{false};
+  std::atomic<bool> computeFlowFields{false};
+  std::atomic<uint64_t> invocationCount{0};
+
+  std::thread worker; // Declared last so everything above exists when it starts
+
+  static void finishCancelled(Job &job) {
+    job.result.cancelled = true;
+    job.promise.set_value(job.result);
+  }
+
+  void run() {
+    for (;;) {
+      std::unique_ptr<Job> job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wakeup.wait(lock, [this]() { return stopping || pending; });
+        if (stopping) {
+          if (pending) finishCancelled(*pending);
+          return;
+        }
+        job = std::move(pending);
+        running = job->cancelFlag;
+      }
+
+      searching.store(true, std::memory_order_relaxed);
+      const auto begin = std::chrono::steady_clock::now();
+      const PlanKey &key = job->result.key;
+      hooks.expandedCells = recordExpansions.load(std::memory_order_relaxed) ? &job->result.expandedCells : nullptr;
+      const bool found = planner.findPath(key.algorithm, key.start, key.startHeading, key.goal, key.goalHeading,
+                                          workspace, job->result.path, job->result.poses, hooks,
+                                          job->cancelFlag.get());
+      const auto end = std::chrono::steady_clock::now();
+      job->result.cancelled = !found && job->cancelFlag->load(std::memory_order_relaxed);
+      if (!job->result.cancelled && computeFlowFields.load(std::memory_order_relaxed)) {
+        job->result.flowField = planner.flowFields().sharedField(key.goal, job->cancelFlag.get());
+      }
+      searching.store(false, std::memory_order_relaxed);
+      invocationCount.fetch_add(1, std::memory_order_relaxed);
+
+      job->result.expanded = workspace.expanded();
+      job->result.stats = hooks.stats;
+      job->result.milliseconds = std::chrono::duration<double, std::milli>(end - begin).count();
+
+      if (!job->result.cancelled) {
+        results.back() = job->result;
+        results.publish();
+      }
+      job->promise.set_value(std::move(job->result));
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        running.reset();
+      }
+      idle.notify_all();
+    }
+  }
+};
+
+} // namespace astar
+
+#endif // ASYNC_PLANNER_HPP_
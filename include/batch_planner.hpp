@@ -0,0 +1,80 @@
+#ifndef BATCH_PLANNER_HPP_
+#define BATCH_PLANNER_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "a_star.hpp"
+#include "grid_planner.hpp"
+#include "occupancy_grid.hpp"
+#include "search_workspace.hpp"
+#include "thread_pool.hpp"
+
+namespace astar {
+
+struct PathQuery {
+  Point start;
+  Point goal;
+};
+
+struct PathResult {
+  std::vector<Point> path;
+  bool found = false;
+  size_t expanded = 0;
+};
+
+/** Answers many path queries on one shared, read-only grid in parallel.
+ *
+ * Queries are spread over a work-stealing ThreadPool; every worker owns one
+ * SearchWorkspace that is reused for all queries it runs. The grid must not
+ * change while findPaths() runs. The planner catches up with grid edits
+ * once, before the queries are dispatched, so the workers only read it.
+ * HPA*, D* Lite and the lattice search keep state inside the planner, so
+ * those queries are answered one at a time.
+ */
+class BatchPlanner {
+public:
+  explicit BatchPlanner(const gridmap::OccupancyGrid &grid_, unsigned threads = 0) :
+    planner(grid_), pool(threads), workspaces(pool.size()) {}
+
+  std::vector<PathResult> findPaths(const PathQuery *queries, size_t count,
+                                    Algorithm algorithm = Algorithm::kAStar) {
+    std::vector<PathResult> results(count);
+    planner.prepare(algorithm); // Catch up with grid edits once, up front
+
+    // Small chunks keep stealing effective; a handful per worker amortizes the queue locks
+    const size_t grain = std::max<size_t>(1, count / (static_cast<size_t>(pool.size()) * 16));
+    pool.parallelFor(count, [&](size_t i, unsigned worker) {
+      PathResult &result = results[i];
+      SearchWorkspace &workspace = workspaces[worker];
+      if (algorithm == Algorithm::kHierarchical || algorithm == Algorithm::kIncremental ||
+          algorithm == Algorithm::kLattice) {
+        std::lock_guard<std::mutex> lock(statefulMutex);
+        result.found = planner.findPath(algorithm, queries[i].start, queries[i].goal, workspace, result.path);
+        return;
+      }
+      result.found = planner.findPathPrepared(algorithm, queries[i].start, queries[i].goal, workspace, result.path);
+      result.expanded = workspace.expanded();
+    }, grain);
+    return results;
+  }
+
+  std::vector<PathResult> findPaths(const std::vector<PathQuery> &queries,
+                                    Algorithm algorithm = Algorithm::kAStar) {
+    return findPaths(queries.data(), queries.size(), algorithm);
+  }
+
+  unsigned threads() const { return pool.size(); }
+
+private:
+  GridPlanner planner;
+  ThreadPool pool;
+  std::vector<SearchWorkspace> workspaces;
+  std::mutex statefulMutex;
+};
+
+} // namespace astar
+
+#endif // BATCH_PLANNER_HPP_
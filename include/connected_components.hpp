@@ -0,0 +1,355 @@
+#ifndef CONNECTED_COMPONENTS_HPP_
+#define CONNECTED_COMPONENTS_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "occupancy_grid.hpp"
+#include "point.hpp"
+#include "thread_pool.hpp"
+
+namespace astar {
+
+/** Labels the 8-connected regions of passable cells, so reachability is a lookup.
+ *
+ * Two passable cells are in the same component exactly when the planners
+ * can move between them. rebuild() works on the packed passability rows:
+ * every row is cut into runs of passable cells with bit operations, runs
+ * of neighboring rows that touch (diagonally included) are joined in a
+ * union-find, and the cells get the label of their run. The rows are split
+ * into bands that are joined in parallel, then the band borders are joined
+ * and the labels written, again in parallel.
+ *
+ * refresh() follows the grid's change journal. A freed cell joins the
+ * components around it. A blocked cell can only split its component if
+ * its passable neighbors are not connected around it; that case, and a
+ * journal that does not reach back far enough, falls back to rebuild().
+ */
+class ConnectedComponents {
+public:
+  explicit ConnectedComponents(const gridmap::OccupancyGrid &grid_, ThreadPool &pool_ = ThreadPool::shared()) :
+    grid(grid_), pool(pool_) {
+    rebuild();
+  }
+
+  /// Relabels every cell.
+  void rebuild() {
+    const int width = grid.width();
+    const int height = grid.height();
+    const size_t words = grid.wordsPerRow();
+
+    // Runs per row, then the runs themselves at their prefix-summed offsets
+    rowStart.assign(static_cast<size_t>(height) + 1, 0);
+    pool.parallelFor(static_cast<size_t>(height), [&](size_t y, unsigned) {
+      uint32_t count = 0;
+      forEachRun(grid.passableRow(static_cast<int>(y)), words, [&](int, int) { ++count; });
+      rowStart[y + 1] = count;
+    }, 16);
+    for (size_t y = 0; y < static_cast<size_t>(height); ++y) rowStart[y + 1] += rowStart[y];
+    runs.resize(rowStart.back());
+    runParent.resize(runs.size());
+    pool.parallelFor(static_cast<size_t>(height), [&](size_t y, unsigned) {
+      uint32_t next = rowStart[y];
+      forEachRun(grid.passableRow(static_cast<int>(y)), words, [&](int x0, int x1) {
+        runParent[next] = next;
+        runs[next++] = {x0, x1};
+      });
+    }, 16);
+
+    // Join rows within bands in parallel; every union stays inside the band's runs
+    const size_t bandCount = std::max<size_t>(1, std::min<size_t>(static_cast<size_t>(height), pool.size() * 4));
+    const size_t bandRows = (static_cast<size_t>(height) + bandCount - 1) / bandCount;
+    pool.parallelFor(bandCount, [&](size_t band, unsigned) {
+      const size_t first = band * bandRows;
+      const size_t last = std::min(static_cast<size_t>(height), first + bandRows);
+      for (size_t y = first + 1; y < last; ++y) joinRows(y - 1, y);
+    });
+    for (size_t y = bandRows; y < static_cast<size_t>(height); y += bandRows) joinRows(y - 1, y);
+
+    // Roots always have the lowest index of their set, so one ascending pass numbers the components
+    runComponent.resize(runs.size());
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < runs.size(); ++i) {
+      const uint32_t root = find(i);
+      runComponent[i] = root == i ? ++count : runComponent[root];
+    }
+
+    labels.resize(grid.cellCount());
+    pool.parallelFor(static_cast<size_t>(height), [&](size_t y, unsigned) {
+      uint32_t *row = labels.data() + y * static_cast<size_t>(width);
+      std::fill(row, row + width, 0u);
+      for (uint32_t r = rowStart[y]; r < rowStart[y + 1]; ++r) {
+        std::fill(row + runs[r].x0, row + runs[r].x1, runComponent[r]);
+      }
+    }, 16);
+
+    labelRoot.resize(static_cast<size_t>(count) + 1);
+    for (uint32_t l = 0; l <= count; ++l) labelRoot[l] = l;
+    components = count;
+    knownVersion = grid.version();
+  }
+
+  /// Catches up with the grid: cell by cell from its change journal, or a rebuild.
+  void refresh() {
+    if (knownVersion == grid.version()) return;
+    changedCells.clear();
+    if (labels.size() != grid.cellCount() || !grid.changesSince(knownVersion, changedCells) ||
+        changedCells.size() > grid.cellCount() / kRebuildFraction) {
+      rebuild();
+      return;
+    }
+    for (const int32_t cell : changedCells) {
+      const int x = cell % grid.width();
+      const int y = cell / grid.width();
+      const bool passable = grid.isPassable(x, y);
+      const bool labeled = labels[static_cast<size_t>(cell)] != 0;
+      if (passable && !labeled) {
+        add(x, y);
+      } else if (!passable && labeled && !remove(x, y)) {
+        rebuild();
+        return;
+      }
+    }
+    // Labels only ever link to lower ones, so an ascending pass leaves every label pointing at its root
+    for (size_t l = 1; l < labelRoot.size(); ++l) labelRoot[l] = labelRoot[labelRoot[l]];
+    knownVersion = grid.version();
+  }
+
+  /// OccupancyGrid::version() the labels are valid for.
+  uint64_t version() const { return knownVersion; }
+
+  size_t componentCount() const { return components; }
+
+  /// Component of a passable cell, 0 for blocked cells. Component ids are not contiguous after refresh().
+  uint32_t component(int x, int y) const { return labelRoot[labels[grid.index(x, y)]]; }
+
+  /** Whether a path from `from` to `to` exists, for cells inside the grid.
+   *
+   * As in the planners, a blocked start may still step onto a passable
+   * neighbor, while a blocked goal can never be reached.
+   */
+  bool connected(const Point &from, const Point &to) const {
+    const uint32_t target = component(to.x, to.y);
+    if (target == 0) return false;
+    const std::array<uint32_t, 8> sources = startComponents(from);
+    return std::find(sources.begin(), sources.end(), target) != sources.end();
+  }
+
+  /** The passable cell reachable from `from` that is closest to `goal`, by Euclidean distance.
+   *
+   * Searches square rings around `goal` until no closer cell can follow,
+   * so a goal next to the reachable region is snapped after a few rings.
+   * Returns false if nothing is reachable from `from`.
+   */
+  bool nearestReachable(const Point &from, const Point &goal, Point &out) const {
+    const std::array<uint32_t, 8> sources = startComponents(from);
+    if (sources[0] == 0) return false;
+    auto reachable = [&](int x, int y) {
+      if (!grid.inBounds(x, y)) return false;
+      const uint32_t c = component(x, y);
+      return c != 0 && std::find(sources.begin(), sources.end(), c) != sources.end();
+    };
+
+    long long best = -1;
+    auto consider = [&](int x, int y) {
+      if (!reachable(x, y)) return;
+      const long long dx = x - goal.x;
+      const long long dy = y - goal.y;
+      const long long distance = dx * dx + dy * dy;
+      if (best < 0 || distance < best) {
+        best = distance;
+        out = Point(x, y);
+      }
+    };
+    consider(goal.x, goal.y);
+    const int maxRadius = std::max(grid.width(), grid.height());
+    for (long long r = 1; r <= maxRadius && (best < 0 || r * r <= best); ++r) {
+      const int radius = static_cast<int>(r);
+      for (int d = -radius; d <= radius; ++d) {
+        consider(goal.x + d, goal.y - radius);
+        consider(goal.x + d, goal.y + radius);
+        if (d == -radius || d == radius) continue;
+        consider(goal.x - radius, goal.y + d);
+        consider(goal.x + radius, goal.y + d);
+      }
+    }
+    return best >= 0;
+  }
+
+private:
+  struct Run {
+    int x0; // First cell
+    int x1; // One past the last cell
+  };
+
+  static constexpr size_t kRebuildFraction = 64; // Rebuild instead when more than 1/64 of the cells changed
+
+  const gridmap::OccupancyGrid &grid;
+  ThreadPool &pool;
+  std::vector<uint32_t> rowStart; // Runs of row y are rowStart[y]..rowStart[y+1]
+  std::vector<Run> runs;
+  std::vector<uint32_t> runParent;
+  std::vector<uint32_t> runComponent;
+  std::vector<uint32_t> labels;    // Per cell, 0 for blocked cells
+  std::vector<uint32_t> labelRoot; // Labels joined by refresh() point at the lowest label of their component
+  std::vector<int32_t> changedCells;
+  size_t components = 0;
+  uint64_t knownVersion = 0;
+
+  /// Calls visit(x0, x1) for every run of passable cells in a packed row, left to right.
+  template <typename Visit>
+  static void forEachRun(const uint64_t *row, size_t words, Visit &&visit) {
+    uint64_t carry = 0;
+    int start = 0;
+    for (size_t w = 0; w < words; ++w) {
+      const uint64_t bits = row[w];
+      uint64_t edges = bits ^ ((bits << 1) | carry); // Bits that differ from the bit before: run starts and ends
+      carry = bits >> 63;
+      while (edges != 0) {
+        const int bit = __builtin_ctzll(edges);
+        edges &= edges - 1;
+        const int x = static_cast<int>(w) * 64 + bit - 1; // Bit 0 is the guard column
+        if ((bits >> bit) & 1u) {
+          start = x;
+        } else {
+          visit(start, x);
+        }
+      }
+    }
+  }
+
+  uint32_t find(uint32_t i) {
+    while (runParent[i] != i) {
+      runParent[i] = runParent[runParent[i]];
+      i = runParent[i];
+    }
+    return i;
+  }
+
+  void unite(uint32_t a, uint32_t b) {
+    a = find(a);
+    b = find(b);
+    if (a == b) return;
+    if (a < b) std::swap(a, b);
+    runParent[a] = b;
+  }
+
+  /// Joins the runs of row y - 1 and row y that touch, diagonally included.
+  void joinRows(size_t above, size_t below) {
+    uint32_t i = rowStart[above];
+    uint32_t j = rowStart[below];
+    while (i < rowStart[above + 1] && j < rowStart[below + 1]) {
+      if (runs[i].x0 <= runs[j].x1 && runs[j].x0 <= runs[i].x1) unite(i, j);
+      if (runs[i].x1 < runs[j].x1) {
+        ++i;
+      } else {
+        ++j;
+      }
+    }
+  }
+
+  uint32_t rootOf(uint32_t label) const {
+    while (labelRoot[label] != label) label = labelRoot[label];
+    return label;
+  }
+
+  /// Labels of the passable cells in the 3x3 neighborhood of (x, y), center excluded, as roots.
+  std::array<uint32_t, 8> neighborRoots(int x, int y) const {
+    std::array<uint32_t, 8> roots{};
+    size_t k = 0;
+    for (int dy = -1; dy <= 1; ++dy) {
+      for (int dx = -1; dx <= 1; ++dx) {
+        if (dx == 0 && dy == 0) continue;
+        const int nx = x + dx;
+        const int ny = y + dy;
+        roots[k++] = grid.inBounds(nx, ny) ? rootOf(labels[grid.index(nx, ny)]) : 0;
+      }
+    }
+    return roots;
+  }
+
+  /// The components a query starting at `from` can enter: its own, or those of its neighbors if it is blocked.
+  std::array<uint32_t, 8> startComponents(const Point &from) const {
+    std::array<uint32_t, 8> sources{};
+    if (!grid.inBounds(from.x, from.y)) return sources;
+    if (grid.isPassable(from.x, from.y)) {
+      sources[0] = component(from.x, from.y);
+      return sources;
+    }
+    size_t k = 0;
+    for (int dy = -1; dy <= 1; ++dy) {
+      for (int dx = -1; dx <= 1; ++dx) {
+        const int nx = from.x + dx;
+        const int ny = from.y + dy;
+        if ((dx == 0 && dy == 0) || !grid.inBounds(nx, ny)) continue;
+        const uint32_t c = component(nx, ny);
+        if (c != 0 && std::find(sources.begin(), sources.begin() + k, c) == sources.begin() + k) sources[k++] = c;
+      }
+    }
+    return sources;
+  }
+
+  /// A freed cell: joins every component around it, or starts a new one.
+  void add(int x, int y) {
+    uint32_t lowest = 0;
+    size_t distinct = 0;
+    const std::array<uint32_t, 8> roots = neighborRoots(x, y);
+    for (size_t k = 0; k < roots.size(); ++k) {
+      const uint32_t root = roots[k];
+      if (root == 0 || std::find(roots.begin(), roots.begin() + k, root) != roots.begin() + k) continue;
+      ++distinct;
+      lowest = lowest == 0 ? root : std::min(lowest, root);
+    }
+    if (lowest == 0) {
+      lowest = static_cast<uint32_t>(labelRoot.size());
+      labelRoot.push_back(lowest);
+    }
+    for (const uint32_t root : roots) {
+      if (root != 0) labelRoot[root] = lowest;
+    }
+    labels[grid.index(x, y)] = lowest;
+    components = components + 1 - distinct;
+  }
+
+  /** A blocked cell; false if its component may have split.
+   *
+   * The passable neighbors of a cell lie on a ring around it. If they are
+   * connected along that ring, every path through the cell has a detour
+   * around it and the component stays whole.
+   */
+  bool remove(int x, int y) {
+    static constexpr int kRing[8][2] = {{-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+    const std::array<uint32_t, 8> roots = neighborRoots(x, y);
+    std::array<int, 8> group{};
+    int groups = 0;
+    for (int a = 0; a < 8; ++a) {
+      if (roots[a] == 0) continue;
+      group[a] = ++groups;
+      for (int b = 0; b < a; ++b) {
+        if (roots[b] == 0 || std::abs(kRing[a][0] - kRing[b][0]) > 1 || std::abs(kRing[a][1] - kRing[b][1]) > 1) {
+          continue;
+        }
+        if (group[b] == group[a]) continue;
+        // Merge a's group into b's
+        const int from = group[a];
+        const int to = group[b];
+        for (int c = 0; c <= a; ++c) {
+          if (group[c] == from) group[c] = to;
+        }
+        --groups;
+      }
+    }
+    if (groups > 1) return false;
+    labels[grid.index(x, y)] = 0;
+    if (groups == 0) --components;
+    return true;
+  }
+};
+
+} // namespace astar
+
+#endif // CONNECTED_COMPONENTS_HPP_
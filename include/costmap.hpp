@@ -0,0 +1,291 @@
+#ifndef COSTMAP_HPP_
+#define COSTMAP_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "occupancy_grid.hpp"
+#include "thread_pool.hpp"
+
+namespace gridmap {
+
+/// Inflation settings, all distances in cells.
+struct InflationParams {
+  float inscribedRadius = 1.0f; // Robot radius; closer cells collide
+  float inflationRadius = 5.0f; // Cost decays to zero here
+  float costScaling = 1.0f;     // Exponential decay per cell beyond the inscribed radius
+};
+
+/** A precomputed clearance layer, e.g. from a map file.
+ *
+ * Distances are in cells and capped at `cap`. The layer only applies to a
+ * grid with the same size and passability hash.
+ */
+struct ClearanceField {
+  const float *distances = nullptr;
+  float cap = 0.0f;
+  int width = 0;
+  int height = 0;
+  uint64_t mapHash = 0;
+  std::shared_ptr<const void> storage; // Keeps `distances` alive
+};
+
+/** Clearance and inflation costs derived from an occupancy grid.
+ *
+ * Every non-passable cell is an obstacle. The distance to the nearest
+ * obstacle comes from the separable Euclidean distance transform of
+ * Felzenszwalb and Huttenlocher: one lower-envelope pass per column, then
+ * one per row, each pass split over a ThreadPool. Distances are exact up to
+ * the inflation radius and capped just beyond it, which is all the costs
+ * need and what makes rectangular updates exact.
+ *
+ * Costs follow the ROS costmap_2d convention: 254 lethal, 253 inscribed,
+ * 252..1 exponential decay, 0 free.
+ */
+class Costmap {
+public:
+  static constexpr uint8_t kLethal = 254;
+  static constexpr uint8_t kInscribed = 253;
+  static constexpr uint8_t kMaxInflated = 252;
+
+  /// Starts from `precomputed` if it fits the grid and reaches the inflation radius, else computes.
+  explicit Costmap(const OccupancyGrid &grid_, InflationParams params_ = InflationParams(),
+                   astar::ThreadPool &pool_ = astar::ThreadPool::shared(),
+                   const ClearanceField &precomputed = ClearanceField()) :
+    grid(grid_), params(params_), pool(pool_) {
+    if (!adopt(precomputed)) rebuild();
+  }
+
+  /// Takes distances from `field` instead of computing them; false if it does not apply.
+  bool adopt(const ClearanceField &field) {
+    if (field.distances == nullptr || field.cap < cap() || field.width != grid.width() ||
+        field.height != grid.height() || field.mapHash != passabilityHash(grid)) {
+      return false;
+    }
+    distance.resize(grid.cellCount());
+    cost.resize(grid.cellCount());
+    const float limit = cap();
+    pool.parallelFor(static_cast<size_t>(grid.height()), [&](size_t row, unsigned) {
+      const size_t begin = row * static_cast<size_t>(grid.width());
+      for (size_t i = begin; i < begin + static_cast<size_t>(grid.width()); ++i) {
+        distance[i] = std::min(field.distances[i], limit);
+        cost[i] = costFor(distance[i]);
+      }
+    }, 16);
+    knownVersion = grid.version();
+    updated = grid.bounds();
+    return true;
+  }
+
+  /// Recomputes every cell.
+  void rebuild() {
+    distance.assign(grid.cellCount(), cap());
+    cost.assign(grid.cellCount(), 0);
+    compute(grid.bounds(), grid.bounds());
+    knownVersion = grid.version();
+    updated = grid.bounds();
+  }
+
+  /** Recomputes the cells whose cost can depend on the cells in `changed`.
+   *
+   * Only cells within the inflation radius of `changed` can change, and only
+   * obstacles within the inflation radius of those matter, so the transform
+   * runs on `changed` grown by twice the radius.
+   */
+  void update(const CellRect &changed) {
+    const int reach = static_cast<int>(std::ceil(params.inflationRadius)) + 1;
+    const CellRect target = changed.expanded(reach).intersected(grid.bounds());
+    if (!target.empty()) compute(target.expanded(reach).intersected(grid.bounds()), target);
+    knownVersion = grid.version();
+    updated = target;
+  }
+
+  /// Catches up with the grid: a rectangular update from its change journal, or a rebuild.
+  void refresh() {
+    if (knownVersion == grid.version()) {
+      updated = CellRect();
+      return;
+    }
+    if (distance.size() != grid.cellCount()) {
+      rebuild();
+      return;
+    }
+    changedCells.clear();
+    if (!grid.changesSince(knownVersion, changedCells)) {
+      rebuild();
+      return;
+    }
+    CellRect changed;
+    for (int32_t cell : changedCells) {
+      const int x = cell % grid.width();
+      const int y = cell / grid.width();
+      changed = changed.united({x, y, x + 1, y + 1});
+    }
+    update(changed);
+  }
+
+  const InflationParams &parameters() const { return params; }
+
+  /// Distance in cells from (x, y) to the nearest obstacle, capped just beyond the inflation radius.
+  float clearance(int x, int y) const { return distance[grid.index(x, y)]; }
+  uint8_t cellCost(int x, int y) const { return cost[grid.index(x, y)]; }
+  uint8_t cellCost(size_t index) const { return cost[index]; }
+  const uint8_t *costs() const { return cost.data(); }
+
+  /// All distances, row-major; values are capped at clearanceCap().
+  const float *clearances() const { return distance.data(); }
+  float clearanceCap() const { return cap(); }
+
+  uint64_t version() const { return knownVersion; }
+
+  /// Cells touched by the last rebuild(), update() or refresh().
+  const CellRect &lastUpdated() const { return updated; }
+
+private:
+  const OccupancyGrid &grid;
+  InflationParams params;
+  astar::ThreadPool &pool;
+  std::vector<float> distance;
+  std::vector<uint8_t> cost;
+  std::vector<float> squared; // Window scratch: squared distance along columns
+  std::vector<int32_t> changedCells;
+  uint64_t knownVersion = 0;
+  CellRect updated;
+
+  /// One lower-envelope scratch set per worker.
+  struct Envelope {
+    std::vector<float> f;
+    std::vector<float> d;
+    std::vector<int> v;
+    std::vector<float> z;
+
+    void resize(int n) {
+      f.resize(n);
+      d.resize(n);
+      v.resize(n);
+      z.resize(n + 1);
+    }
+  };
+  std::vector<Envelope> envelopes;
+
+  static constexpr float kFar = 1e20f;
+
+  float cap() const { return std::ceil(params.inflationRadius) + 1.0f; }
+
+  /// 1D squared distance transform of f[0..n) into d (Felzenszwalb & Huttenlocher).
+  /// Free cells (f >= kFar) are left out of the lower envelope.
+  static void transform(Envelope &e, int n) {
+    const float infinity = std::numeric_limits<float>::infinity();
+    int k = -1;
+    for (int q = 0; q < n; ++q) {
+      if (e.f[q] >= kFar) continue;
+      if (k < 0) {
+        k = 0;
+        e.v[0] = q;
+        e.z[0] = -infinity;
+        e.z[1] = infinity;
+        continue;
+      }
+      float s;
+      for (;;) {
+        const int p = e.v[k];
+        s = ((e.f[q] + static_cast<float>(q) * q) - (e.f[p] + static_cast<float>(p) * p)) /
+            (2.0f * static_cast<float>(q - p));
+        if (s > e.z[k]) break;
+        --k; // z[0] is -infinity, so this stops at k == 0
+      }
+      ++k;
+      e.v[k] = q;
+      e.z[k] = s;
+      e.z[k + 1] = infinity;
+    }
+    if (k < 0) {
+      std::fill(e.d.begin(), e.d.begin() + n, kFar);
+      return;
+    }
+    k = 0;
+    for (int q = 0; q < n; ++q) {
+      while (e.z[k + 1] < static_cast<float>(q)) ++k;
+      const float dq = static_cast<float>(q - e.v[k]);
+      e.d[q] = dq * dq + e.f[e.v[k]];
+    }
+  }
+
+  /// Distance transform over `window`; distances and costs are written for `target` only.
+  void compute(const CellRect &window, const CellRect &target) {
+    const int ww = window.width();
+    const int wh = window.height();
+    squared.resize(static_cast<size_t>(ww) * static_cast<size_t>(wh));
+    envelopes.resize(pool.size());
+    for (Envelope &e : envelopes) e.resize(std::max(ww, wh));
+
+    pool.parallelFor(static_cast<size_t>(ww), [&](size_t column, unsigned worker) {
+      Envelope &e = envelopes[worker];
+      const int x = window.x0 + static_cast<int>(column);
+      for (int i = 0; i < wh; ++i) e.f[i] = grid.isPassable(x, window.y0 + i) ? kFar : 0.0f;
+      transform(e, wh);
+      for (int i = 0; i < wh; ++i) squared[static_cast<size_t>(i) * ww + column] = e.d[i];
+    }, 16);
+
+    const float limit = cap();
+    pool.parallelFor(static_cast<size_t>(target.height()), [&](size_t row, unsigned worker) {
+      Envelope &e = envelopes[worker];
+      const int y = target.y0 + static_cast<int>(row);
+      const float *line = squared.data() + static_cast<size_t>(y - window.y0) * ww;
+      std::copy(line, line + ww, e.f.begin());
+      transform(e, ww);
+      for (int x = target.x0; x < target.x1; ++x) {
+        const float d = std::min(std::sqrt(e.d[x - window.x0]), limit);
+        const size_t index = grid.index(x, y);
+        distance[index] = d;
+        cost[index] = costFor(d);
+      }
+    }, 16);
+  }
+
+  uint8_t costFor(float d) const {
+    if (d <= 0.0f) return kLethal;
+    if (d <= params.inscribedRadius) return kInscribed;
+    if (d > params.inflationRadius) return 0;
+    const float c = static_cast<float>(kMaxInflated) * std::exp(-params.costScaling * (d - params.inscribedRadius));
+    return static_cast<uint8_t>(std::max(1.0f, c));
+  }
+};
+
+/** Per-cell step cost factor for BasicAStar, read from a Costmap.
+ *
+ * Entering a cell costs the geometric step times 1 + weight * cost / 252,
+ * so free space keeps the plain step cost and the octile heuristic stays
+ * admissible. Inscribed cells are expensive but not forbidden, so narrow
+ * maze corridors stay connected; lethal cells are impassable anyway.
+ */
+class CostmapTraversal {
+public:
+  CostmapTraversal() = default;
+
+  explicit CostmapTraversal(const Costmap &costmap_, float weight = 3.0f) : costmap(&costmap_) {
+    for (int c = 0; c <= Costmap::kMaxInflated; ++c) {
+      factor[c] = 1.0f + weight * static_cast<float>(c) / static_cast<float>(Costmap::kMaxInflated);
+    }
+    factor[Costmap::kInscribed] = 1.0f + 4.0f * weight;
+    factor[Costmap::kLethal] = std::numeric_limits<float>::infinity();
+    factor[255] = std::numeric_limits<float>::infinity();
+  }
+
+  float operator()(int32_t index) const {
+    return costmap == nullptr ? 1.0f : factor[costmap->cellCost(static_cast<size_t>(index))];
+  }
+
+private:
+  const Costmap *costmap = nullptr;
+  std::array<float, 256> factor{};
+};
+
+} // namespace gridmap
+
+#endif // COSTMAP_HPP_
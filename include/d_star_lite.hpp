@@ -0,0 +1,293 @@
+#ifndef D_STAR_LITE_HPP_
+#define D_STAR_LITE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "a_star.hpp"
+#include "occupancy_grid.hpp"
+
+namespace astar {
+
+/** Incremental planner (D* Lite) that keeps its search between queries.
+ *
+ * The search runs backwards from the goal, so the robot moving along the path
+ * only shifts the heuristic (the key modifier km) and map edits only touch
+ * the cells next to the changed ones. Edits are read from the grid's change
+ * journal; if it no longer reaches back far enough, or the goal moved, the
+ * search starts over. Movement rules match AStar: 8-connected, a move only
+ * needs the target cell to be free.
+ */
+class DStarLite {
+public:
+  explicit DStarLite(const gridmap::OccupancyGrid &grid_) : grid(grid_) {}
+
+  /** Plans from `from` to `to`, reusing whatever is still valid from the last call.
+   *
+   * If `cancel` is set while repairing, false is returned and the repair
+   * continues from where it stopped on the next call.
+   */
+  bool findPath(const Point &from, const Point &to, std::vector<Point> &path,
+                const std::atomic<bool> *cancel = nullptr) {
+    path.clear();
+    expandedCount = 0;
+    repairedCount = 0;
+    if (!grid.inBounds(from.x, from.y) || !grid.inBounds(to.x, to.y)) return false;
+    if (from == to) {
+      path.push_back(from);
+      return true;
+    }
+
+    if (!initialized || to != goal || nodes.size() != grid.cellCount()) {
+      reset(from, to);
+    } else if (grid.version() != knownVersion) {
+      changed.clear();
+      if (!grid.changesSince(knownVersion, changed)) {
+        reset(from, to);
+      } else {
+        if (from != start) moveStart(from);
+        applyChanges();
+      }
+    } else if (from != start) {
+      moveStart(from);
+    }
+    knownVersion = grid.version();
+
+    if (!computeShortestPath(cancel)) return false;
+    return extractPath(path);
+  }
+
+  /// Drops all search state; the next query searches from scratch.
+  void invalidate() { initialized = false; }
+
+  size_t expanded() const { return expandedCount; }
+  size_t repairedCells() const { return repairedCount; }
+
+private:
+  static constexpr float kInfinity = std::numeric_limits<float>::infinity();
+
+  struct Key {
+    float k1;
+    float k2;
+
+    bool operator<(const Key &o) const { return k1 < o.k1 || (k1 == o.k1 && k2 < o.k2); }
+    bool operator==(const Key &o) const { return k1 == o.k1 && k2 == o.k2; }
+  };
+
+  struct Node {
+    float g = kInfinity;
+    float rhs = kInfinity;
+    Key key{0.0f, 0.0f};
+    bool open = false;
+  };
+
+  struct QueueEntry {
+    Key key;
+    int32_t index;
+
+    bool operator<(const QueueEntry &o) const { return o.key < key; } // Min-heap
+  };
+
+  const gridmap::OccupancyGrid &grid;
+  std::vector<Node> nodes;
+  std::vector<QueueEntry> queue; // Binary heap with lazy deletion
+  std::vector<int32_t> changed;
+  Point start, goal;
+  float km = 0.0f;
+  uint64_t knownVersion = 0;
+  bool initialized = false;
+  size_t expandedCount = 0;
+  size_t repairedCount = 0;
+
+  const float diagonalCost = std::sqrt(2.0f);
+  const float straightCost = 1.0f;
+
+  void reset(const Point &from, const Point &to) {
+    nodes.assign(grid.cellCount(), Node());
+    queue.clear();
+    start = from;
+    goal = to;
+    km = 0.0f;
+    initialized = true;
+
+    const int32_t goalIndex = indexOf(goal);
+    nodes[goalIndex].rhs = 0.0f;
+    push(goalIndex);
+  }
+
+  void moveStart(const Point &from) {
+    km += heuristic(start, from);
+    start = from;
+  }
+
+  void applyChanges() {
+    // Entering a changed cell got cheaper or more expensive for all of its neighbors
+    const int width = grid.width();
+    for (int32_t cell : changed) {
+      const int cx = cell % width;
+      const int cy = cell / width;
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+          if ((dx != 0 || dy != 0) && grid.inBounds(cx + dx, cy + dy)) {
+            updateVertex(indexOf(Point(cx + dx, cy + dy)));
+          }
+        }
+      }
+      ++repairedCount;
+    }
+  }
+
+  Key calculateKey(int32_t index) const {
+    const Node &node = nodes[index];
+    const float best = std::min(node.g, node.rhs);
+    return {best + heuristic(start, pointOf(index)) + km, best};
+  }
+
+  void push(int32_t index) {
+    Node &node = nodes[index];
+    node.key = calculateKey(index);
+    node.open = true;
+    queue.push_back({node.key, index});
+    std::push_heap(queue.begin(), queue.end());
+  }
+
+  /// Drops entries for nodes that left the queue or were re-queued with another key.
+  void pruneTop() {
+    while (!queue.empty()) {
+      const QueueEntry &top = queue.front();
+      const Node &node = nodes[top.index];
+      if (node.open && node.key == top.key) return;
+      std::pop_heap(queue.begin(), queue.end());
+      queue.pop_back();
+    }
+  }
+
+  void updateVertex(int32_t index) {
+    Node &node = nodes[index];
+    if (index != indexOf(goal)) {
+      float best = kInfinity;
+      const Point p = pointOf(index);
+      unsigned neighbors = grid.passableNeighborhood(p.x, p.y) & ~(1u << 4);
+      while (neighbors != 0) {
+        const int bit = __builtin_ctz(neighbors);
+        neighbors &= neighbors - 1;
+        const int x = bit % 3 - 1;
+        const int y = bit / 3 - 1;
+        const float g = nodes[indexOf(Point(p.x + x, p.y + y))].g;
+        best = std::min(best, g + ((x == 0 || y == 0) ? straightCost : diagonalCost));
+      }
+      node.rhs = best;
+    }
+    if (node.g != node.rhs) {
+      push(index);
+    } else {
+      node.open = false;
+    }
+  }
+
+  bool computeShortestPath(const std::atomic<bool> *cancel) {
+    const int32_t startIndex = indexOf(start);
+    for (;;) {
+      pruneTop();
+      if (queue.empty()) break;
+      const Node &startNode = nodes[startIndex];
+      if (!(queue.front().key < calculateKey(startIndex)) && startNode.rhs <= startNode.g) break;
+
+      const QueueEntry top = queue.front();
+      std::pop_heap(queue.begin(), queue.end());
+      queue.pop_back();
+      Node &node = nodes[top.index];
+
+      const Key fresh = calculateKey(top.index);
+      if (top.key < fresh) {
+        push(top.index); // Key got stale after the start moved
+        continue;
+      }
+
+      ++expandedCount;
+      if (cancelRequested(cancel, expandedCount)) {
+        push(top.index);
+        return false;
+      }
+
+      node.open = false;
+      if (node.g > node.rhs) {
+        node.g = node.rhs;
+        updatePredecessors(top.index);
+      } else {
+        node.g = kInfinity;
+        updateVertex(top.index);
+        updatePredecessors(top.index);
+      }
+    }
+    return true;
+  }
+
+  /// Every in-grid neighbor can step onto a free cell; nothing can step onto an occupied one.
+  void updatePredecessors(int32_t index) {
+    const Point p = pointOf(index);
+    if (!grid.isPassable(p.x, p.y)) return;
+    for (int dy = -1; dy <= 1; ++dy) {
+      for (int dx = -1; dx <= 1; ++dx) {
+        if ((dx != 0 || dy != 0) && grid.inBounds(p.x + dx, p.y + dy)) {
+          updateVertex(indexOf(Point(p.x + dx, p.y + dy)));
+        }
+      }
+    }
+  }
+
+  bool extractPath(std::vector<Point> &path) const {
+    // The start may stay locally underconsistent; its rhs is the path cost
+    const Node &startNode = nodes[indexOf(start)];
+    if (std::min(startNode.g, startNode.rhs) == kInfinity || !grid.isPassable(goal.x, goal.y)) return false;
+
+    Point current = start;
+    path.push_back(current);
+    const size_t maxSteps = grid.cellCount();
+    while (current != goal && path.size() <= maxSteps) {
+      float best = kInfinity;
+      Point next = current;
+      unsigned neighbors = grid.passableNeighborhood(current.x, current.y) & ~(1u << 4);
+      while (neighbors != 0) {
+        const int bit = __builtin_ctz(neighbors);
+        neighbors &= neighbors - 1;
+        const int x = bit % 3 - 1;
+        const int y = bit / 3 - 1;
+        const Point candidate(current.x + x, current.y + y);
+        const float cost = nodes[indexOf(candidate)].g + ((x == 0 || y == 0) ? straightCost : diagonalCost);
+        if (cost < best) {
+          best = cost;
+          next = candidate;
+        }
+      }
+      if (best == kInfinity) {
+        path.clear();
+        return false;
+      }
+      current = next;
+      path.push_back(current);
+    }
+    if (current != goal) {
+      path.clear();
+      return false;
+    }
+    return true;
+  }
+
+  static float heuristic(const Point &a, const Point &b) {
+    const float dx = static_cast<float>(a.x - b.x);
+    const float dy = static_cast<float>(a.y - b.y);
+    return std::sqrt(dx * dx + dy * dy);
+  }
+
+  int32_t indexOf(const Point &p) const { return static_cast<int32_t>(grid.index(p.x, p.y)); }
+  Point pointOf(int32_t index) const { return Point(index % grid.width(), index / grid.width()); }
+};
+
+} // namespace astar
+
+#endif // D_STAR_LITE_HPP_
@@ -0,0 +1,307 @@
+#ifndef FLOW_FIELD_HPP_
+#define FLOW_FIELD_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "a_star.hpp"
+#include "occupancy_grid.hpp"
+#include "point.hpp"
+#include "thread_pool.hpp"
+
+namespace astar {
+
+/** Cost to reach one goal from every cell of the grid.
+ *
+ * A reverse Dijkstra from the goal over the same moves and costs as
+ * BasicAStar, so the cost of a cell equals the cost of the path A* would
+ * find from it. Once computed, findPath() walks down the field from any
+ * start in O(path length), which makes one field cheaper than a search per
+ * agent as soon as a handful of agents share the goal.
+ *
+ * The frontier is kept in buckets of width 1 (delta-stepping). Every step
+ * costs at least 1, so relaxing the cells of the lowest bucket can only
+ * reach higher buckets: all cells of that bucket are final and are relaxed
+ * in parallel, lowering their neighbors' costs with an atomic min. Buckets
+ * below kParallelBucket cells, which is all of them in maze corridors, are
+ * relaxed on the calling thread. `CostModel` factors must be at least 1.
+ */
+template <typename CostModel = UniformCost>
+class BasicFlowField {
+public:
+  static constexpr float kUnreachable = std::numeric_limits<float>::infinity();
+  static constexpr size_t kParallelBucket = 2048;
+
+  /** Computes the field of `goal`; a blocked goal leaves every cell unreachable.
+   *
+   * `cancel` is polled once per bucket. A cancelled computation returns
+   * false and leaves the field incomplete, to be computed again.
+   */
+  bool compute(const gridmap::OccupancyGrid &grid, const Point &goal_, ThreadPool &pool,
+               CostModel costModel_ = CostModel(), const std::atomic<bool> *cancel = nullptr) {
+    gridWidth = grid.width();
+    gridHeight = grid.height();
+    goalCell = goal_;
+    version = grid.version();
+    costModel = std::move(costModel_);
+    reached = 0;
+    highest = 0.0f;
+    costs.assign(grid.cellCount(), kUnreachable);
+    if (!grid.inBounds(goal_.x, goal_.y) || !grid.isPassable(goal_.x, goal_.y)) return true;
+
+    settled.assign(grid.cellCount(), 0);
+    ring.assign(4, {});
+    outputs.resize(pool.size());
+    const int32_t goalIndex = goal_.y * gridWidth + goal_.x;
+    costs[static_cast<size_t>(goalIndex)] = 0.0f;
+    ring[0].push_back(goalIndex);
+    size_t pending = 1;
+
+    for (size_t bucket = 0; pending > 0; ++bucket) {
+      std::vector<int32_t> &current = ring[bucket % ring.size()];
+      if (current.empty()) continue;
+      if (cancelRequested(cancel)) {
+        for (std::vector<int32_t> &cells : ring) cells.clear();
+        return false;
+      }
+      pending -= current.size();
+      if (current.size() < kParallelBucket) {
+        for (const int32_t cell : current) relax(grid, cell, bucket, outputs[0]);
+      } else {
+        pool.parallelFor(current.size(), [&](size_t i, unsigned worker) {
+          relax(grid, current[i], bucket, outputs[worker]);
+        }, 256);
+      }
+      current.clear();
+
+      for (std::vector<Relaxed> &output : outputs) {
+        for (const Relaxed &entry : output) {
+          if (entry.bucket - bucket >= ring.size()) grow(bucket, entry.bucket);
+          ring[entry.bucket % ring.size()].push_back(entry.cell);
+        }
+        pending += output.size();
+        output.clear();
+      }
+    }
+
+    for (const float c : costs) {
+      if (c == kUnreachable) continue;
+      ++reached;
+      highest = std::max(highest, c);
+    }
+    return true;
+  }
+
+  const Point &goal() const { return goalCell; }
+  /// OccupancyGrid::version() the field was computed for.
+  uint64_t mapVersion() const { return version; }
+  int width() const { return gridWidth; }
+  int height() const { return gridHeight; }
+
+  float cost(int x, int y) const { return costs[static_cast<size_t>(y) * gridWidth + x]; }
+  float cost(const Point &p) const { return cost(p.x, p.y); }
+  bool reachable(const Point &p) const { return cost(p) != kUnreachable; }
+
+  /// Number of cells with a finite cost.
+  size_t reachedCells() const { return reached; }
+  /// Largest finite cost, 0 if nothing is reachable.
+  float maxCost() const { return highest; }
+  const std::vector<float> &data() const { return costs; }
+
+  /** The path from `from` to the goal, both included; false if the goal cannot be reached.
+   *
+   * Each step moves to the neighbor that minimizes its cost plus the cost of
+   * entering it, which is the step the reverse search settled. As in
+   * BasicAStar, the start cell itself may be blocked.
+   */
+  bool findPath(const Point &from, std::vector<Point> &path) const {
+    path.clear();
+    if (reached == 0 || from.x < 0 || from.y < 0 || from.x >= gridWidth || from.y >= gridHeight) return false;
+    Point p = from;
+    path.push_back(p);
+    // Costs strictly decrease along the walk; the bound only guards against rounding
+    for (size_t steps = 0; p != goalCell && steps < costs.size(); ++steps) {
+      float best = kUnreachable;
+      Point next = p;
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+          const int nx = p.x + dx;
+          const int ny = p.y + dy;
+          if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= gridWidth || ny >= gridHeight) continue;
+          const int32_t index = ny * gridWidth + nx;
+          const float remaining = costs[static_cast<size_t>(index)];
+          if (remaining == kUnreachable) continue;
+          const float total = remaining + ((dx == 0 || dy == 0) ? 1.0f : kSqrt2) * costModel(index);
+          if (total < best) {
+            best = total;
+            next = Point(nx, ny);
+          }
+        }
+      }
+      if (best == kUnreachable) {
+        path.clear();
+        return false;
+      }
+      p = next;
+      path.push_back(p);
+    }
+    if (p != goalCell) path.clear();
+    return p == goalCell;
+  }
+
+private:
+  struct Relaxed {
+    size_t bucket;
+    int32_t cell;
+  };
+
+  static constexpr float kSqrt2 = 1.41421356f;
+
+  int gridWidth = 0;
+  int gridHeight = 0;
+  Point goalCell;
+  uint64_t version = 0;
+  CostModel costModel;
+  size_t reached = 0;
+  float highest = 0.0f;
+  std::vector<float> costs;
+  std::vector<uint8_t> settled;
+  std::vector<std::vector<int32_t>> ring; // Bucket b lives at b % size(); spans every bucket still pending
+  std::vector<std::vector<Relaxed>> outputs; // Per worker, merged into the ring after each bucket
+
+  /// Lowers `target` to `value` if that is lower; false if it was not.
+  static bool atomicMin(float &target, float value) {
+    float seen;
+    __atomic_load(&target, &seen, __ATOMIC_RELAXED);
+    while (value < seen) {
+      if (__atomic_compare_exchange(&target, &seen, &value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) return true;
+    }
+    return false;
+  }
+
+  /// Relaxes the neighbors of a cell of bucket `bucket`; the cell's cost is final.
+  void relax(const gridmap::OccupancyGrid &grid, int32_t cell, size_t bucket, std::vector<Relaxed> &output) {
+    const float base = costs[static_cast<size_t>(cell)];
+    // A cell reached again at a lower cost left an entry in a later bucket
+    if (static_cast<size_t>(base) != bucket) return;
+    if (__atomic_exchange_n(&settled[static_cast<size_t>(cell)], uint8_t{1}, __ATOMIC_RELAXED) != 0) return;
+
+    // Leaving a neighbor towards this cell costs the step times this cell's factor
+    const float factor = costModel(cell);
+    if (factor == kUnreachable) return;
+    const float straight = base + factor;
+    const float diagonal = base + kSqrt2 * factor;
+
+    const int cx = cell % gridWidth;
+    const int cy = cell / gridWidth;
+    unsigned neighbors = grid.passableNeighborhood(cx, cy) & ~(1u << 4);
+    while (neighbors != 0) {
+      const int bit = __builtin_ctz(neighbors);
+      neighbors &= neighbors - 1;
+      const int x = bit % 3 - 1;
+      const int y = bit / 3 - 1;
+      const int32_t neighbor = (cy + y) * gridWidth + cx + x;
+      const float candidate = (x == 0 || y == 0) ? straight : diagonal;
+      if (atomicMin(costs[static_cast<size_t>(neighbor)], candidate)) {
+        output.push_back({static_cast<size_t>(candidate), neighbor});
+      }
+    }
+  }
+
+  /// Widens the ring until it spans `bucket` through `needed`, keeping every pending bucket.
+  void grow(size_t bucket, size_t needed) {
+    size_t size = ring.size();
+    while (needed - bucket >= size) size *= 2;
+    std::vector<std::vector<int32_t>> wider(size);
+    for (size_t b = bucket; b < bucket + ring.size(); ++b) wider[b % size] = std::move(ring[b % ring.size()]);
+    ring = std::move(wider);
+  }
+};
+
+using FlowField = BasicFlowField<>;
+
+/** The flow fields of the most recently used goals on one grid.
+ *
+ * field() returns the cached field if it was computed for the same goal
+ * and grid version, and otherwise recomputes the least recently used one
+ * in its place, on the given worker threads. A returned reference
+ * stays valid until a later field() call evicts it; sharedField() hands
+ * out fields that outlive eviction, e.g. to another thread. Not
+ * thread-safe.
+ */
+template <typename CostModel = UniformCost>
+class BasicFlowFieldCache {
+public:
+  explicit BasicFlowFieldCache(const gridmap::OccupancyGrid &grid_, size_t capacity = 4,
+                               ThreadPool &pool_ = ThreadPool::shared(), CostModel costModel_ = CostModel()) :
+    grid(grid_), costModel(std::move(costModel_)), pool(pool_) {
+    entries.resize(std::max<size_t>(1, capacity));
+  }
+
+  const BasicFlowField<CostModel> &field(const Point &goal) { return *sharedField(goal); }
+
+  /** field() that stays alive while the caller holds it; null if `cancel` stopped the computation.
+   *
+   * A field still held outside the cache is never recomputed in place: its
+   * slot gets a new field instead.
+   */
+  std::shared_ptr<const BasicFlowField<CostModel>> sharedField(const Point &goal,
+                                                               const std::atomic<bool> *cancel = nullptr) {
+    ++clock;
+    Entry *victim = &entries.front();
+    for (Entry &entry : entries) {
+      if (entry.field && entry.field->goal() == goal && entry.field->mapVersion() == grid.version()) {
+        entry.lastUse = clock;
+        ++hitCount;
+        return entry.field;
+      }
+      if (entry.lastUse < victim->lastUse) victim = &entry;
+    }
+    ++missCount;
+    if (!victim->field || victim->field.use_count() > 1) {
+      victim->field = std::make_shared<BasicFlowField<CostModel>>();
+    }
+    if (!victim->field->compute(grid, goal, pool, costModel, cancel)) {
+      victim->field.reset();
+      victim->lastUse = 0;
+      return nullptr;
+    }
+    victim->lastUse = clock;
+    return victim->field;
+  }
+
+  /// field(goal).findPath(from, path).
+  bool findPath(const Point &from, const Point &goal, std::vector<Point> &path) {
+    return field(goal).findPath(from, path);
+  }
+
+  size_t hits() const { return hitCount; }
+  size_t misses() const { return missCount; }
+
+private:
+  struct Entry {
+    std::shared_ptr<BasicFlowField<CostModel>> field;
+    uint64_t lastUse = 0;
+  };
+
+  const gridmap::OccupancyGrid &grid;
+  CostModel costModel;
+  ThreadPool &pool;
+  std::vector<Entry> entries;
+  uint64_t clock = 0;
+  size_t hitCount = 0;
+  size_t missCount = 0;
+};
+
+using FlowFieldCache = BasicFlowFieldCache<>;
+
+} // namespace astar
+
+#endif // FLOW_FIELD_HPP_
@@ -0,0 +1,331 @@
+#ifndef GRID_PLANNER_HPP_
+#define GRID_PLANNER_HPP_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "a_star.hpp"
+#include "connected_components.hpp"
+#include "costmap.hpp"
+#include "d_star_lite.hpp"
+#include "flow_field.hpp"
+#include "hpa_star.hpp"
+#include "jump_point_search.hpp"
+#include "landmarks.hpp"
+#include "lattice_planner.hpp"
+#include "occupancy_grid.hpp"
+#include "path_smoothing.hpp"
+#include "search_stats.hpp"
+#include "search_workspace.hpp"
+
+namespace astar {
+
+enum class Algorithm {
+  kAStar,
+  kJumpPoint,
+  kJumpPointBitScan,
+  kHierarchical,
+  kIncremental,
+  kLandmarks,
+  kCostAware,
+  kLattice,
+};
+
+inline const char *algorithmName(Algorithm algorithm) {
+  switch (algorithm) {
+    case Algorithm::kAStar: return "A*";
+    case Algorithm::kJumpPoint: return "JPS";
+    case Algorithm::kJumpPointBitScan: return "JPS (bit scan)";
+    case Algorithm::kHierarchical: return "HPA*";
+    case Algorithm::kIncremental: return "D* Lite";
+    case Algorithm::kLandmarks: return "A* (ALT)";
+    case Algorithm::kCostAware: return "A* (costmap)";
+    case Algorithm::kLattice: return "SE(2) lattice";
+  }
+  return "?";
+}
+
+/// Planner data computed ahead of time, e.g. stored in a map file; each part is used only if it fits the grid.
+struct PlannerIndices {
+  std::string landmarkCache;                      // Where ALT tables are cached; empty for none
+  std::shared_ptr<const LandmarkTable> landmarks; // Preloaded ALT tables
+  gridmap::ClearanceField clearance;              // Seeds the costmap
+};
+
+/** Dispatches a query on one shared grid to the selected search algorithm.
+ *
+ * The hierarchical planner is preprocessed on first use and, when the grid
+ * changes, updated around the journaled edits. A query's cancel flag also
+ * stops a full HPA* rebuild, which the next query then starts over; the
+ * update around a local edit always runs to the end. The incremental planner
+ * keeps its search between calls and repairs it from the grid's change
+ * journal. The ALT landmark
+ * tables are taken from the indices if they match the grid, else built on
+ * first use or by prepare(), in parallel, and cached in `landmarkCache` if a path is given.
+ * Edits that only block cells keep the tables: distances on the edited map
+ * are no shorter, so their bounds stay admissible. A freed cell rebuilds
+ * them, which the cancel flag can stop, and only the tables of the map as
+ * it was when the planner was constructed are cached.
+ * The cost-aware search keeps a Costmap
+ * that follows grid edits through rectangular updates in prepare(). The SE(2) lattice
+ * search builds its motion primitive tables on first use and takes its
+ * heuristic from a cache of flow fields to recent goals, which also
+ * serves flowFields() callers.
+ *
+ * Every query is first checked against a ConnectedComponents index, built
+ * with the planner and kept up to date from the change journal: a goal
+ * the start cannot reach is rejected without a search, and a goal inside
+ * an obstacle is moved to the closest cell the start can reach, where the
+ * returned path then ends.
+ *
+ * findPath() catches up with grid edits first, so a GridPlanner must only
+ * be used from one thread. The exception is concurrent findPathPrepared()
+ * queries with A*, JPS, ALT or the costmap: after prepare() for that
+ * algorithm they only read the planner, for as long as the grid does not
+ * change.
+ */
+class GridPlanner {
+public:
+  static constexpr size_t kLandmarkCount = 16;
+
+  explicit GridPlanner(const gridmap::OccupancyGrid &grid_, std::string landmarkCache = std::string()) :
+    GridPlanner(grid_, PlannerIndices{std::move(landmarkCache), nullptr, gridmap::ClearanceField()}) {}
+
+  GridPlanner(const gridmap::OccupancyGrid &grid_, PlannerIndices indices_) :
+    grid(grid_), aStar(grid_, Point(), Point()), jumpPoint(grid_, false), jumpPointBitScan(grid_, true),
+    indices(std::move(indices_)), loadedVersion(grid_.version()), components(grid_) {}
+
+  bool findPath(Algorithm algorithm, const Point &from, const Point &to, SearchWorkspace &workspace,
+                std::vector<Point> &path, const std::atomic<bool> *cancel = nullptr) const {
+    NoSearchHooks hooks;
+    return findPath(algorithm, from, to, workspace, path, hooks, cancel);
+  }
+
+  /** findPath() reporting to `hooks` (see search_stats.hpp).
+   *
+   * HPA* and D* Lite keep their own search state, so for them the hooks only
+   * see the whole query as one expand phase.
+   */
+  template <typename Hooks>
+  bool findPath(Algorithm algorithm, const Point &from, const Point &to, SearchWorkspace &workspace,
+                std::vector<Point> &path, Hooks &hooks, const std::atomic<bool> *cancel = nullptr) const {
+    return query(algorithm, from, 0.0f, to, 0.0f, workspace, path, nullptr, hooks, cancel);
+  }
+
+  /** findPath() between poses, headings in radians in cell coordinates.
+   *
+   * Only the lattice search uses the headings; it also fills `poses` with
+   * the drivable path, see LatticePlanner. For the other algorithms `poses`
+   * is left empty.
+   */
+  template <typename Hooks>
+  bool findPath(Algorithm algorithm, const Point &from, float fromHeading, const Point &to, float toHeading,
+                SearchWorkspace &workspace, std::vector<Point> &path, std::vector<PathPose> &poses, Hooks &hooks,
+                const std::atomic<bool> *cancel = nullptr) const {
+    poses.clear();
+    return query(algorithm, from, fromHeading, to, toHeading, workspace, path, &poses, hooks, cancel);
+  }
+
+  /** Catches up with grid edits for queries with `algorithm`: the reachability index and the algorithm's tables.
+   *
+   * findPath() does this itself; it is needed once before concurrent
+   * findPathPrepared() queries and again after every grid change.
+   */
+  void prepare(Algorithm algorithm, const std::atomic<bool> *cancel = nullptr) const {
+    components.refresh();
+    if (algorithm == Algorithm::kHierarchical) hierarchicalPlanner(cancel);
+    if (algorithm == Algorithm::kLandmarks) landmarkPlanner(cancel);
+    if (algorithm == Algorithm::kCostAware) costAwarePlanner();
+  }
+
+  /** findPath() that reads the planner as the last prepare() left it, for concurrent queries.
+   *
+   * Nothing is updated or built, so several threads may query A*, JPS, ALT
+   * or the costmap at once, each with its own workspace, while the grid
+   * does not change; HPA*, ALT and the costmap need prepare() for their
+   * algorithm first.
+   */
+  bool findPathPrepared(Algorithm algorithm, const Point &from, const Point &to, SearchWorkspace &workspace,
+                        std::vector<Point> &path, const std::atomic<bool> *cancel = nullptr) const {
+    NoSearchHooks hooks;
+    return checkedSearch(algorithm, from, 0.0f, to, 0.0f, workspace, path, nullptr, hooks, cancel);
+  }
+
+  /// Reachability index the queries are checked against, as of the last query or prepare().
+  const ConnectedComponents &connectedComponents() const { return components; }
+
+  /// The HPA* planner, caught up with the grid unless `cancel` stopped a full build, see isComplete().
+  HierarchicalPlanner &hierarchicalPlanner(const std::atomic<bool> *cancel = nullptr) const {
+    if (!hierarchical) {
+      hierarchical =
+        std::make_unique<HierarchicalPlanner>(grid, HierarchicalPlanner::kDefaultClusterSize, cancel);
+    } else if (!hierarchical->isComplete()) {
+      hierarchical->rebuild(cancel);
+    } else if (hierarchical->version() != grid.version()) {
+      // Edits only touch the clusters around them; a bulk rewrite leaves no journal and needs a rebuild
+      changedCells.clear();
+      if (grid.changesSince(hierarchical->version(), changedCells)) {
+        gridmap::CellRect changed;
+        for (int32_t cell : changedCells) {
+          const int x = cell % grid.width();
+          const int y = cell / grid.width();
+          changed = changed.united({x, y, x + 1, y + 1});
+        }
+        hierarchical->updateRegion(changed);
+      } else {
+        hierarchical->rebuild(cancel);
+      }
+    }
+    return *hierarchical;
+  }
+
+  /// The ALT search with tables that fit the grid; null if `cancel` stopped building them.
+  const BasicAStar<LandmarkHeuristic> *landmarkPlanner(const std::atomic<bool> *cancel = nullptr) const {
+    if (landmarks && landmarkVersion != grid.version()) {
+      // Every cell passable now was passable for the tables, unless the journal says otherwise
+      changedCells.clear();
+      bool onlyBlocked = grid.changesSince(landmarkVersion, changedCells);
+      for (size_t i = 0; onlyBlocked && i < changedCells.size(); ++i) {
+        onlyBlocked = !grid.isPassable(changedCells[i] % grid.width(), changedCells[i] / grid.width());
+      }
+      if (onlyBlocked) landmarkVersion = grid.version();
+    }
+    if (!landmarks || landmarkVersion != grid.version()) {
+      std::shared_ptr<const LandmarkTable> table = indices.landmarks;
+      if (!table || table->width != grid.width() || table->height != grid.height() ||
+          table->mapHash != passabilityHash(grid)) {
+        const std::string cache = grid.version() == loadedVersion ? indices.landmarkCache : std::string();
+        table = loadOrBuildLandmarks(grid, kLandmarkCount, cache, ThreadPool::shared(), cancel);
+        if (!table) return nullptr;
+      }
+      LandmarkHeuristic heuristic(std::move(table));
+      landmarks = std::make_unique<BasicAStar<LandmarkHeuristic>>(grid, Point(), Point(), std::move(heuristic));
+      landmarkVersion = grid.version();
+    }
+    return landmarks.get();
+  }
+
+  /// The cost-aware search, with its Costmap built or brought up to date with the grid.
+  const BasicAStar<OctileHeuristic, gridmap::CostmapTraversal> &costAwarePlanner() const {
+    if (!costmap) {
+      costmap = std::make_unique<gridmap::Costmap>(grid, gridmap::InflationParams(), ThreadPool::shared(),
+                                                   indices.clearance);
+      costAware = std::make_unique<BasicAStar<OctileHeuristic, gridmap::CostmapTraversal>>(
+        grid, Point(), Point(), OctileHeuristic(), gridmap::CostmapTraversal(*costmap));
+    } else {
+      costmap->refresh();
+    }
+    return *costAware;
+  }
+
+  DStarLite &incrementalPlanner() const {
+    if (!incremental) incremental = std::make_unique<DStarLite>(grid);
+    return *incremental;
+  }
+
+  /// Flow fields to the most recent goals, recomputed when the grid changes.
+  FlowFieldCache &flowFields() const {
+    if (!flowFieldCache) flowFieldCache = std::make_unique<FlowFieldCache>(grid);
+    return *flowFieldCache;
+  }
+
+  LatticePlanner &latticePlanner() const {
+    if (!lattice) lattice = std::make_unique<LatticePlanner>(grid, flowFields());
+    return *lattice;
+  }
+
+private:
+  template <typename Hooks>
+  bool query(Algorithm algorithm, const Point &from, float fromHeading, const Point &to, float toHeading,
+             SearchWorkspace &workspace, std::vector<Point> &path, std::vector<PathPose> *poses, Hooks &hooks,
+             const std::atomic<bool> *cancel) const {
+    prepare(algorithm, cancel);
+    return checkedSearch(algorithm, from, fromHeading, to, toHeading, workspace, path, poses, hooks, cancel);
+  }
+
+  /// query() against the reachability index as it is, without catching up with the grid.
+  template <typename Hooks>
+  bool checkedSearch(Algorithm algorithm, const Point &from, float fromHeading, const Point &to, float toHeading,
+                     SearchWorkspace &workspace, std::vector<Point> &path, std::vector<PathPose> *poses,
+                     Hooks &hooks, const std::atomic<bool> *cancel) const {
+    // A goal outside the grid is a flood, and a query to its own start cell is left to the algorithms
+    if (from == to || !grid.inBounds(from.x, from.y) || !grid.inBounds(to.x, to.y)) {
+      return search(algorithm, from, fromHeading, to, toHeading, workspace, path, poses, hooks, cancel);
+    }
+    Point goal = to;
+    if (!grid.isPassable(to.x, to.y) && !components.nearestReachable(from, to, goal)) {
+      return rejected(workspace, path, hooks);
+    }
+    if (!components.connected(from, goal)) return rejected(workspace, path, hooks);
+    return search(algorithm, from, fromHeading, goal, toHeading, workspace, path, poses, hooks, cancel);
+  }
+
+  template <typename Hooks>
+  bool search(Algorithm algorithm, const Point &from, float fromHeading, const Point &to, float toHeading,
+              SearchWorkspace &workspace, std::vector<Point> &path, std::vector<PathPose> *poses, Hooks &hooks,
+              const std::atomic<bool> *cancel) const {
+    switch (algorithm) {
+      case Algorithm::kJumpPoint:
+        return jumpPoint.findPath(from, to, workspace, path, hooks, cancel);
+      case Algorithm::kJumpPointBitScan:
+        return jumpPointBitScan.findPath(from, to, workspace, path, hooks, cancel);
+      case Algorithm::kHierarchical:
+        return timedAsOnePhase(workspace, hooks, [&]() { return hierarchical->findPath(from, to, path, cancel); });
+      case Algorithm::kIncremental:
+        return timedAsOnePhase(workspace, hooks, [&]() { return incrementalPlanner().findPath(from, to, path, cancel); });
+      case Algorithm::kLandmarks:
+        // Prepared tables, unless prepare() was cancelled
+        if (!landmarks || landmarkVersion != grid.version()) return rejected(workspace, path, hooks);
+        return landmarks->findPath(from, to, workspace, path, hooks, cancel);
+      case Algorithm::kCostAware:
+        return costAware->findPath(from, to, workspace, path, hooks, cancel); // Refreshed by prepare()
+      case Algorithm::kLattice:
+        return latticePlanner().findPath(from, fromHeading, to, toHeading, workspace, path, poses, hooks, cancel);
+      case Algorithm::kAStar:
+      default:
+        return aStar.findPath(from, to, workspace, path, hooks, cancel);
+    }
+  }
+
+  /// An unreachable goal: an empty query as far as the hooks and the expansion count are concerned.
+  template <typename Hooks>
+  bool rejected(SearchWorkspace &workspace, std::vector<Point> &path, Hooks &hooks) const {
+    path.clear();
+    hooks.begin(workspace);
+    workspace.prepare(grid.width(), grid.height());
+    hooks.end(workspace);
+    return false;
+  }
+
+  template <typename Hooks, typename Search>
+  static bool timedAsOnePhase(const SearchWorkspace &workspace, Hooks &hooks, Search &&search) {
+    hooks.begin(workspace);
+    hooks.phase(SearchPhase::kExpand);
+    const bool found = search();
+    hooks.end(workspace);
+    return found;
+  }
+
+  const gridmap::OccupancyGrid &grid;
+  AStar aStar;
+  JumpPointSearch jumpPoint;
+  JumpPointSearch jumpPointBitScan;
+  mutable std::unique_ptr<HierarchicalPlanner> hierarchical;
+  mutable std::unique_ptr<DStarLite> incremental;
+  PlannerIndices indices;
+  mutable std::unique_ptr<BasicAStar<LandmarkHeuristic>> landmarks;
+  mutable uint64_t landmarkVersion = 0; // Grid version the tables are valid for
+  uint64_t loadedVersion;                // Grid version at construction; only its tables are cached
+  mutable std::unique_ptr<gridmap::Costmap> costmap;
+  mutable std::unique_ptr<BasicAStar<OctileHeuristic, gridmap::CostmapTraversal>> costAware;
+  mutable ConnectedComponents components;
+  mutable std::unique_ptr<FlowFieldCache> flowFieldCache;
+  mutable std::unique_ptr<LatticePlanner> lattice;
+  mutable std::vector<int32_t> changedCells;
+};
+
+} // namespace astar
+
+#endif // GRID_PLANNER_HPP_
@@ -0,0 +1,111 @@
+#ifndef HEURISTICS_HPP_
+#define HEURISTICS_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "point.hpp"
+
+namespace astar {
+
+/** Admissible distance estimates for the 8-connected grid (straight 1, diagonal sqrt(2)).
+ *
+ * A heuristic is any copyable type with `float operator()(const Point &from,
+ * const Point &to) const`; BasicAStar takes it as a template parameter so
+ * the call is inlined into the search loop.
+ */
+
+/// Straight-line distance. Admissible, but loose on 8-connected grids.
+struct EuclideanHeuristic {
+  float operator()(const Point &a, const Point &b) const {
+    const float dx = static_cast<float>(a.x - b.x);
+    const float dy = static_cast<float>(a.y - b.y);
+    return std::sqrt(dx * dx + dy * dy);
+  }
+};
+
+/// Exact distance on an empty 8-connected grid; no square root.
+struct OctileHeuristic {
+  float operator()(const Point &a, const Point &b) const {
+    const int dx = std::abs(a.x - b.x);
+    const int dy = std::abs(a.y - b.y);
+    const int diagonal = std::min(dx, dy);
+    return static_cast<float>(std::max(dx, dy)) + kDiagonalExtra * static_cast<float>(diagonal);
+  }
+
+  static constexpr float kDiagonalExtra = 0.41421356f; // sqrt(2) - 1
+};
+
+/** Shortest-path costs from a few landmark cells to every cell of one map.
+ *
+ * Distances are stored landmark-major; unreachable cells hold infinity.
+ * See landmarks.hpp for building, saving and loading tables.
+ */
+struct LandmarkTable {
+  int width = 0;
+  int height = 0;
+  uint64_t mapHash = 0;
+  std::vector<Point> landmarks;
+  std::vector<float> distances;
+  // Set instead of `distances` when the table lives in memory it does not own, e.g. a mapped map file
+  const float *externalDistances = nullptr;
+  std::shared_ptr<const void> storage; // Keeps externalDistances alive
+
+  size_t cellCount() const { return static_cast<size_t>(width) * static_cast<size_t>(height); }
+
+  const float *distanceData() const { return externalDistances != nullptr ? externalDistances : distances.data(); }
+  const float *distancesFrom(size_t landmark) const { return distanceData() + landmark * cellCount(); }
+};
+
+/** ALT heuristic: landmarks and the triangle inequality.
+ *
+ * For a landmark L, |d(L, a) - d(L, b)| never exceeds the cost from a to b
+ * (paths between free cells are reversible), so the maximum over all
+ * landmarks, and over the octile distance, is admissible and consistent. On
+ * mazes it is far tighter than any geometric estimate because it accounts
+ * for the walls.
+ */
+class LandmarkHeuristic {
+public:
+  LandmarkHeuristic() = default;
+
+  explicit LandmarkHeuristic(std::shared_ptr<const LandmarkTable> table_) : table(std::move(table_)) {}
+
+  float operator()(const Point &a, const Point &b) const {
+    float best = octile(a, b);
+    if (!table || !inTable(a) || !inTable(b)) return best;
+
+    const size_t ia = static_cast<size_t>(a.y) * table->width + a.x;
+    const size_t ib = static_cast<size_t>(b.y) * table->width + b.x;
+    const size_t cells = table->cellCount();
+    const float *d = table->distanceData();
+    for (size_t l = 0; l < table->landmarks.size(); ++l, d += cells) {
+      const float da = d[ia];
+      const float db = d[ib];
+      if (da == kUnreachable || db == kUnreachable) continue;
+      best = std::max(best, std::fabs(da - db));
+    }
+    return best;
+  }
+
+  const LandmarkTable *landmarkTable() const { return table.get(); }
+
+  static constexpr float kUnreachable = std::numeric_limits<float>::infinity();
+
+private:
+  std::shared_ptr<const LandmarkTable> table;
+  OctileHeuristic octile;
+
+  bool inTable(const Point &p) const {
+    return p.x >= 0 && p.x < table->width && p.y >= 0 && p.y < table->height;
+  }
+};
+
+} // namespace astar
+
+#endif // HEURISTICS_HPP_
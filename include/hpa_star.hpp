@@ -0,0 +1,473 @@
+#ifndef HPA_STAR_HPP_
+#define HPA_STAR_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include "a_star.hpp"
+#include "heuristics.hpp"
+#include "occupancy_grid.hpp"
+#include "search_workspace.hpp"
+
+namespace astar {
+
+class HierarchicalPlanner;
+
+/** Abstract path returned by HierarchicalPlanner.
+ *
+ * Holds the entrance waypoints only; the cell-level path between two
+ * consecutive waypoints is computed when refineNext() reaches it, so a caller
+ * that only needs the next few meters never pays for the whole route.
+ */
+class HierarchicalPath {
+public:
+  const std::vector<Point> &waypoints() const { return abstractPath; }
+  bool empty() const { return abstractPath.empty(); }
+  bool done() const { return nextSegment + 1 >= abstractPath.size(); }
+  float cost() const { return totalCost; }
+
+  /// Appends the cells of the next abstract edge to `path`; false once fully refined.
+  bool refineNext(std::vector<Point> &path);
+
+private:
+  friend class HierarchicalPlanner;
+
+  HierarchicalPlanner *planner = nullptr;
+  std::vector<Point> abstractPath;
+  size_t nextSegment = 0;
+  float totalCost = 0.0f;
+};
+
+/** HPA*: hierarchical path abstraction on top of AStar.
+ *
+ * The grid is split into square clusters. Entrances are placed on every run
+ * of passable cells shared by two adjacent clusters (plus the diagonal steps
+ * that are the only way across), and the distances between
+ * the entrances of one cluster are precomputed with AStar searches confined
+ * to that cluster. Queries connect start and goal to the entrances of their
+ * clusters and search the small abstract graph; the result is refined lazily.
+ *
+ * updateRegion() only rebuilds the clusters overlapping an edit, plus any
+ * neighbor whose shared border entrances changed as a result.
+ *
+ * A full build and the queries poll an optional cancel flag. A cancelled
+ * build leaves the planner incomplete: it answers no queries until
+ * rebuild() runs to the end.
+ */
+class HierarchicalPlanner {
+public:
+  static constexpr int kDefaultClusterSize = 16;
+
+  explicit HierarchicalPlanner(const gridmap::OccupancyGrid &grid_, int clusterSize_ = kDefaultClusterSize,
+                               const std::atomic<bool> *cancel = nullptr) :
+    grid(grid_), planner(grid_, Point(), Point()), clusterSize(clusterSize_) {
+    rebuild(cancel);
+  }
+
+  /// Full preprocessing of every cluster; false if cancelled, which leaves the planner incomplete.
+  bool rebuild(const std::atomic<bool> *cancel = nullptr) {
+    complete = false;
+    clustersX = (grid.width() + clusterSize - 1) / clusterSize;
+    clustersY = (grid.height() + clusterSize - 1) / clusterSize;
+    const size_t clusterCount = static_cast<size_t>(clustersX) * static_cast<size_t>(clustersY);
+    eastBorders.assign(clusterCount, {});
+    northBorders.assign(clusterCount, {});
+    cornerBorders.assign(clusterCount, {});
+    clusters.assign(clusterCount, {});
+
+    for (int c = 0; c < static_cast<int>(clusterCount); ++c) {
+      if (cancelRequested(cancel)) return false;
+      eastBorders[c] = buildBorder(c, true);
+      northBorders[c] = buildBorder(c, false);
+      cornerBorders[c] = buildCorners(c);
+    }
+    for (int c = 0; c < static_cast<int>(clusterCount); ++c) {
+      if (cancelRequested(cancel)) return false;
+      rebuildCluster(c);
+    }
+    builtVersion = grid.version();
+    complete = true;
+    return true;
+  }
+
+  /// Rebuilds only what an edit inside `changed` can affect.
+  void updateRegion(const gridmap::CellRect &changed) {
+    const gridmap::CellRect region = changed.expanded(1).intersected(grid.bounds());
+    if (region.empty()) {
+      builtVersion = grid.version();
+      return;
+    }
+    const int cx0 = region.x0 / clusterSize;
+    const int cy0 = region.y0 / clusterSize;
+    const int cx1 = (region.x1 - 1) / clusterSize;
+    const int cy1 = (region.y1 - 1) / clusterSize;
+
+    std::vector<int> dirty;
+    auto markDirty = [&](int c) {
+      if (std::find(dirty.begin(), dirty.end(), c) == dirty.end()) dirty.push_back(c);
+    };
+    auto refreshBorder = [&](int c, bool east) {
+      std::vector<Transition> &border = east ? eastBorders[c] : northBorders[c];
+      std::vector<Transition> updated = buildBorder(c, east);
+      if (updated != border) {
+        border = std::move(updated);
+        markDirty(c);
+        markDirty(east ? c + 1 : c + clustersX);
+      }
+    };
+    auto refreshCorners = [&](int c) {
+      std::vector<Transition> updated = buildCorners(c);
+      if (updated != cornerBorders[c]) {
+        for (const auto &t : cornerBorders[c]) markDirty(clusterOf(cellOf(t.outside)));
+        for (const auto &t : updated) markDirty(clusterOf(cellOf(t.outside)));
+        cornerBorders[c] = std::move(updated);
+        markDirty(c);
+      }
+    };
+
+    for (int cy = cy0; cy <= cy1; ++cy) {
+      for (int cx = cx0; cx <= cx1; ++cx) {
+        const int c = clusterId(cx, cy);
+        markDirty(c);
+        refreshBorder(c, true);
+        refreshBorder(c, false);
+        refreshCorners(c);
+        if (cx > 0) refreshBorder(c - 1, true);
+        if (cy > 0) refreshBorder(c - clustersX, false);
+        if (cy > 0 && cx > 0) refreshCorners(c - clustersX - 1);
+        if (cy > 0 && cx + 1 < clustersX) refreshCorners(c - clustersX + 1);
+      }
+    }
+    for (int c : dirty) rebuildCluster(c);
+    clustersRebuilt += dirty.size();
+    builtVersion = grid.version();
+  }
+
+  /// Searches the abstract graph. Returns false if the goal is unreachable or the search was cancelled.
+  bool findAbstractPath(const Point &from, const Point &to, HierarchicalPath &out,
+                        const std::atomic<bool> *cancel = nullptr) {
+    out = HierarchicalPath();
+    out.planner = this;
+    if (!complete || !grid.inBounds(from.x, from.y) || !grid.isPassable(to.x, to.y)) return false;
+
+    const int32_t startIndex = indexOf(from.x, from.y);
+    const int32_t goalIndex = indexOf(to.x, to.y);
+    const int startCluster = clusterOf(from.x, from.y);
+    const int goalCluster = clusterOf(to.x, to.y);
+
+    // Connect start and goal to the entrances of their clusters. Costs are
+    // symmetric, so one flood from the goal covers every entrance -> goal edge.
+    floodCosts(startCluster, from, startCosts);
+    floodCosts(goalCluster, to, goalCosts);
+
+    // Neighboring clusters also get a direct edge, so nearby queries are not
+    // forced through an entrance.
+    const int dcx = std::abs(startCluster % clustersX - goalCluster % clustersX);
+    const int dcy = std::abs(startCluster / clustersX - goalCluster / clustersX);
+    float directCost = kInfinity;
+    if (dcx <= 1 && dcy <= 1 &&
+        planner.findPathWithin(segmentBounds(from, to), from, to, clusterWorkspace, scratchPath, cancel)) {
+      directCost = clusterWorkspace.node(goalIndex).gCost;
+    }
+
+    using State = SearchWorkspace::State;
+    abstractWorkspace.prepare(grid.width(), grid.height());
+    abstractWorkspace.open(startIndex, 0.0f, -1);
+    abstractWorkspace.pushOpen(heuristic(from, to), heuristic(from, to), startIndex);
+
+    auto relax = [&](int32_t fromIndex, float gCost, int32_t toIndex, float edgeCost) {
+      if (edgeCost >= kInfinity) return;
+      const float newGCost = gCost + edgeCost;
+      const State state = abstractWorkspace.state(toIndex);
+      if (state == State::kClosed) return;
+      if (state == State::kOpen && abstractWorkspace.node(toIndex).gCost <= newGCost) return;
+      abstractWorkspace.open(toIndex, newGCost, fromIndex);
+      const float hCost = heuristic(cellOf(toIndex), to);
+      abstractWorkspace.pushOpen(newGCost + hCost, hCost, toIndex);
+    };
+
+    while (!abstractWorkspace.openEmpty()) {
+      const SearchWorkspace::OpenEntry entry = abstractWorkspace.popOpen();
+      SearchWorkspace::NodeRecord &current = abstractWorkspace.node(entry.index);
+      if (current.state == State::kClosed) continue;
+      current.state = State::kClosed;
+      abstractWorkspace.countExpansion();
+      if (cancelRequested(cancel, abstractWorkspace.expanded())) return false;
+      const float gCost = current.gCost;
+
+      if (entry.index == goalIndex) {
+        for (int32_t index = goalIndex; index != -1; index = abstractWorkspace.node(index).parent) {
+          out.abstractPath.push_back(cellOf(index));
+        }
+        std::reverse(out.abstractPath.begin(), out.abstractPath.end());
+        out.totalCost = gCost;
+        return true;
+      }
+
+      if (entry.index == startIndex) {
+        const Cluster &data = clusters[startCluster];
+        for (size_t i = 0; i < data.entrances.size(); ++i) {
+          relax(entry.index, gCost, data.entrances[i], startCosts[i]);
+        }
+        relax(entry.index, gCost, goalIndex, directCost);
+      }
+
+      const Point cell = cellOf(entry.index);
+      const int c = clusterOf(cell.x, cell.y);
+      const Cluster &data = clusters[c];
+      const int local = entranceIndex(data, entry.index);
+      if (local < 0) continue;
+
+      const size_t n = data.entrances.size();
+      for (size_t j = 0; j < n; ++j) {
+        relax(entry.index, gCost, data.entrances[j], data.distances[local * n + j]);
+      }
+      for (const auto &link : data.links) {
+        if (link.first == local) relax(entry.index, gCost, link.second, heuristic(cell, cellOf(link.second)));
+      }
+      if (c == goalCluster) {
+        relax(entry.index, gCost, goalIndex, goalCosts[local]);
+      }
+    }
+    return false;
+  }
+
+  /// Abstract search followed by full refinement; `cancel` is also polled between refined edges.
+  bool findPath(const Point &from, const Point &to, std::vector<Point> &path,
+                const std::atomic<bool> *cancel = nullptr) {
+    path.clear();
+    HierarchicalPath abstract;
+    if (!findAbstractPath(from, to, abstract, cancel)) return false;
+    if (abstract.done()) path.push_back(from); // start == goal
+    while (!abstract.done()) {
+      if (cancelRequested(cancel)) {
+        path.clear();
+        return false;
+      }
+      abstract.refineNext(path);
+    }
+    return true;
+  }
+
+  uint64_t version() const { return builtVersion; }
+  /// False after a cancelled rebuild().
+  bool isComplete() const { return complete; }
+  size_t rebuiltClusterCount() const { return clustersRebuilt; }
+
+  size_t entranceCount() const {
+    size_t count = 0;
+    for (const auto &cluster : clusters) count += cluster.entrances.size();
+    return count;
+  }
+
+private:
+  friend class HierarchicalPath;
+
+  struct Transition {
+    int32_t inside;  // cell in the cluster owning the border
+    int32_t outside; // cell in the east or north neighbor
+
+    bool operator==(const Transition &o) const { return inside == o.inside && outside == o.outside; }
+    bool operator!=(const Transition &o) const { return !(*this == o); }
+  };
+
+  struct Cluster {
+    std::vector<int32_t> entrances;              // sorted cell indices
+    std::vector<float> distances;                // entrances x entrances, kInfinity if unreachable
+    std::vector<std::pair<int, int32_t>> links;  // (local entrance, partner cell in a neighbor)
+  };
+
+  static constexpr float kInfinity = std::numeric_limits<float>::infinity();
+  static constexpr int kLongEntrance = 6; // Runs at least this long get an entrance at both ends
+  const float straightCost = 1.0f;
+  const float diagonalCost = std::sqrt(2.0f);
+
+  const gridmap::OccupancyGrid &grid;
+  AStar planner;
+  int clusterSize;
+  int clustersX = 0;
+  int clustersY = 0;
+  std::vector<std::vector<Transition>> eastBorders;
+  std::vector<std::vector<Transition>> northBorders;
+  std::vector<std::vector<Transition>> cornerBorders;
+  std::vector<Cluster> clusters;
+  uint64_t builtVersion = 0;
+  bool complete = false;
+  size_t clustersRebuilt = 0;
+
+  SearchWorkspace abstractWorkspace;
+  SearchWorkspace clusterWorkspace;
+  std::vector<Point> scratchPath;
+  std::vector<float> startCosts;
+  std::vector<float> goalCosts;
+  std::vector<float> scratchCosts;
+
+  int clusterId(int cx, int cy) const { return cy * clustersX + cx; }
+  int clusterOf(int x, int y) const { return clusterId(x / clusterSize, y / clusterSize); }
+  int clusterOf(const Point &p) const { return clusterOf(p.x, p.y); }
+
+  gridmap::CellRect clusterRect(int c) const {
+    const int x0 = (c % clustersX) * clusterSize;
+    const int y0 = (c / clustersX) * clusterSize;
+    return {x0, y0, std::min(x0 + clusterSize, grid.width()), std::min(y0 + clusterSize, grid.height())};
+  }
+
+  int32_t indexOf(int x, int y) const { return static_cast<int32_t>(grid.index(x, y)); }
+  Point cellOf(int32_t index) const { return Point(index % grid.width(), index / grid.width()); }
+
+  static int entranceIndex(const Cluster &cluster, int32_t cell) {
+    auto it = std::lower_bound(cluster.entrances.begin(), cluster.entrances.end(), cell);
+    if (it == cluster.entrances.end() || *it != cell) return -1;
+    return static_cast<int>(it - cluster.entrances.begin());
+  }
+
+  float heuristic(const Point &a, const Point &b) const { return OctileHeuristic()(a, b); }
+
+  /// Search bounds for the cell path between two abstract nodes.
+  gridmap::CellRect segmentBounds(const Point &a, const Point &b) const {
+    return clusterRect(clusterOf(a)).united(clusterRect(clusterOf(b)));
+  }
+
+  /// Costs from `from` to every entrance of cluster c, staying inside the cluster.
+  void floodCosts(int c, const Point &from, std::vector<float> &costs) {
+    const Cluster &cluster = clusters[c];
+    planner.floodWithin(clusterRect(c), from, clusterWorkspace);
+    costs.assign(cluster.entrances.size(), kInfinity);
+    for (size_t i = 0; i < costs.size(); ++i) {
+      const int32_t cell = cluster.entrances[i];
+      if (clusterWorkspace.state(cell) == SearchWorkspace::State::kClosed) {
+        costs[i] = clusterWorkspace.node(cell).gCost;
+      }
+    }
+  }
+
+  /// Entrances on the east (or north) border of cluster c.
+  std::vector<Transition> buildBorder(int c, bool east) const {
+    std::vector<Transition> border;
+    const gridmap::CellRect rect = clusterRect(c);
+    if (east ? rect.x1 >= grid.width() : rect.y1 >= grid.height()) return border;
+
+    const int length = east ? rect.height() : rect.width();
+    auto insideCell = [&](int i) { return east ? Point(rect.x1 - 1, rect.y0 + i) : Point(rect.x0 + i, rect.y1 - 1); };
+    auto outsideCell = [&](int i) { return east ? Point(rect.x1, rect.y0 + i) : Point(rect.x0 + i, rect.y1); };
+    auto passable = [&](const Point &p) { return grid.isPassable(p.x, p.y); };
+    auto open = [&](int i) { return passable(insideCell(i)) && passable(outsideCell(i)); };
+    auto addTransition = [&](int i, int o) {
+      const Point a = insideCell(i);
+      const Point b = outsideCell(o);
+      border.push_back({indexOf(a.x, a.y), indexOf(b.x, b.y)});
+    };
+
+    for (int i = 0; i < length;) {
+      if (!open(i)) {
+        ++i;
+        continue;
+      }
+      int end = i;
+      while (end + 1 < length && open(end + 1)) ++end;
+      if (end - i + 1 >= kLongEntrance) {
+        addTransition(i, i);
+        addTransition(end, end);
+      } else {
+        addTransition((i + end) / 2, (i + end) / 2);
+      }
+      i = end + 1;
+    }
+
+    // A diagonal step across the border is the only connection when neither
+    // straight pair next to it is open.
+    for (int i = 0; i + 1 < length; ++i) {
+      if (open(i) || open(i + 1)) continue;
+      if (passable(insideCell(i)) && passable(outsideCell(i + 1))) addTransition(i, i + 1);
+      if (passable(insideCell(i + 1)) && passable(outsideCell(i))) addTransition(i + 1, i);
+    }
+    return border;
+  }
+
+  /// Diagonal-only links from the top corners of cluster c to its NE and NW neighbors.
+  std::vector<Transition> buildCorners(int c) const {
+    std::vector<Transition> corners;
+    const gridmap::CellRect rect = clusterRect(c);
+    if (rect.y1 >= grid.height()) return corners;
+    auto link = [&](int ix, int ox, int sideX) {
+      const int iy = rect.y1 - 1;
+      const int oy = rect.y1;
+      if (grid.isPassable(ix, iy) && grid.isPassable(ox, oy) &&
+          !grid.isPassable(ix, oy) && !grid.isPassable(sideX, iy)) {
+        corners.push_back({indexOf(ix, iy), indexOf(ox, oy)});
+      }
+    };
+    if (rect.x1 < grid.width()) link(rect.x1 - 1, rect.x1, rect.x1);
+    if (rect.x0 > 0) link(rect.x0, rect.x0 - 1, rect.x0 - 1);
+    return corners;
+  }
+
+  void rebuildCluster(int c) {
+    Cluster &cluster = clusters[c];
+    cluster.entrances.clear();
+    cluster.links.clear();
+
+    // Every transition touching this cluster, owned ones first.
+    const int cx = c % clustersX;
+    const int cy = c / clustersX;
+    std::vector<std::pair<const std::vector<Transition> *, bool>> sources = {
+      {&eastBorders[c], true}, {&northBorders[c], true}, {&cornerBorders[c], true}};
+    if (cx > 0) sources.push_back({&eastBorders[c - 1], false});
+    if (cy > 0) sources.push_back({&northBorders[c - clustersX], false});
+    if (cy > 0 && cx > 0) sources.push_back({&cornerBorders[c - clustersX - 1], false});
+    if (cy > 0 && cx + 1 < clustersX) sources.push_back({&cornerBorders[c - clustersX + 1], false});
+
+    auto forEachTransition = [&](auto &&visit) {
+      for (const auto &source : sources) {
+        for (const auto &t : *source.first) {
+          if (source.second) {
+            visit(t.inside, t.outside);
+          } else if (clusterOf(cellOf(t.outside)) == c) {
+            visit(t.outside, t.inside);
+          }
+        }
+      }
+    };
+
+    forEachTransition([&](int32_t mine, int32_t) { cluster.entrances.push_back(mine); });
+    std::sort(cluster.entrances.begin(), cluster.entrances.end());
+    cluster.entrances.erase(std::unique(cluster.entrances.begin(), cluster.entrances.end()),
+                            cluster.entrances.end());
+    forEachTransition([&](int32_t mine, int32_t theirs) {
+      cluster.links.emplace_back(entranceIndex(cluster, mine), theirs);
+    });
+
+    const size_t n = cluster.entrances.size();
+    cluster.distances.assign(n * n, kInfinity);
+    for (size_t i = 0; i < n; ++i) {
+      floodCosts(c, cellOf(cluster.entrances[i]), scratchCosts);
+      std::copy(scratchCosts.begin(), scratchCosts.end(), cluster.distances.begin() + i * n);
+    }
+  }
+
+  /// Cell path for one abstract edge, appended without repeating `a`.
+  void refineSegment(const Point &a, const Point &b, std::vector<Point> &path) {
+    if (path.empty()) path.push_back(a);
+    if (a == b) return;
+    // Uses the same bounds the edge cost was computed with.
+    if (planner.findPathWithin(segmentBounds(a, b), a, b, clusterWorkspace, scratchPath)) {
+      path.insert(path.end(), scratchPath.begin() + 1, scratchPath.end());
+    }
+  }
+};
+
+inline bool HierarchicalPath::refineNext(std::vector<Point> &path) {
+  if (planner == nullptr || done()) return false;
+  planner->refineSegment(abstractPath[nextSegment], abstractPath[nextSegment + 1], path);
+  ++nextSegment;
+  return true;
+}
+
+} // namespace astar
+
+#endif // HPA_STAR_HPP_
@@ -0,0 +1,293 @@
+#ifndef JUMP_POINT_SEARCH_HPP_
+#define JUMP_POINT_SEARCH_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "a_star.hpp"
+#include "heuristics.hpp"
+#include "occupancy_grid.hpp"
+#include "search_stats.hpp"
+#include "search_workspace.hpp"
+
+namespace astar {
+
+/** Jump Point Search for the uniform-cost 8-connected grid used by AStar.
+ *
+ * Uses the same movement model as AStar (diagonal moves only need the target
+ * cell to be free) and therefore the original pruning rules of Harabor and
+ * Grastien. Returned paths have the same cost as AStar's and are expanded
+ * back to one point per cell.
+ *
+ * With `bitScan` enabled, horizontal jumps scan 64 cells at a time over the
+ * packed passability rows, looking for the first blocked cell or forced
+ * neighbor with a single bit scan (the JPS-B variant).
+ */
+class JumpPointSearch {
+public:
+  explicit JumpPointSearch(const gridmap::OccupancyGrid &grid_, bool bitScan_ = true) :
+    grid(&grid_), bitScan(bitScan_) {}
+
+  bool findPath(const Point &from, const Point &to, SearchWorkspace &workspace,
+                std::vector<Point> &path, const std::atomic<bool> *cancel = nullptr) const {
+    NoSearchHooks hooks;
+    return findPath(from, to, workspace, path, hooks, cancel);
+  }
+
+  /// findPath() reporting to `hooks`, see search_stats.hpp.
+  template <typename Hooks>
+  bool findPath(const Point &from, const Point &to, SearchWorkspace &workspace, std::vector<Point> &path,
+                Hooks &hooks, const std::atomic<bool> *cancel = nullptr) const {
+    using State = SearchWorkspace::State;
+
+    path.clear();
+    if (!grid->inBounds(from.x, from.y) || !grid->inBounds(to.x, to.y)) return false;
+
+    hooks.begin(workspace);
+    const int width = grid->width();
+    workspace.prepare(width, grid->height());
+    const int32_t startIndex = indexOf(from.x, from.y);
+    const int32_t goalIndex = indexOf(to.x, to.y);
+
+    workspace.open(startIndex, 0.0f, -1);
+    const float startH = heuristic(from.x, from.y, to);
+    workspace.pushOpen(startH, startH, startIndex);
+    hooks.push(false, workspace.openSize());
+    hooks.phase(SearchPhase::kExpand);
+
+    int directions[8][2];
+    while (!workspace.openEmpty()) {
+      const SearchWorkspace::OpenEntry entry = workspace.popOpen();
+      SearchWorkspace::NodeRecord &current = workspace.node(entry.index);
+      if (current.state == State::kClosed) {
+        hooks.stalePop();
+        continue;
+      }
+      current.state = State::kClosed;
+      workspace.countExpansion();
+      hooks.expand(entry.index);
+      if (cancelRequested(cancel, workspace.expanded())) {
+        hooks.end(workspace);
+        return false;
+      }
+
+      const int cx = entry.index % width;
+      const int cy = entry.index / width;
+
+      if (entry.index == goalIndex) {
+        hooks.phase(SearchPhase::kPath);
+        buildPath(workspace, goalIndex, path);
+        hooks.end(workspace);
+        return true;
+      }
+
+      const int count = prunedDirections(cx, cy, current.parent, directions);
+      for (int i = 0; i < count; ++i) {
+        int jx, jy;
+        if (!jump(cx, cy, directions[i][0], directions[i][1], to, jx, jy)) continue;
+
+        const int32_t jumpIndex = indexOf(jx, jy);
+        const State state = workspace.state(jumpIndex);
+        if (state == State::kClosed) continue;
+
+        const float newGCost = current.gCost + distance(cx, cy, jx, jy);
+        if (state == State::kOpen && workspace.node(jumpIndex).gCost <= newGCost) continue;
+
+        workspace.open(jumpIndex, newGCost, entry.index);
+        const float hCost = heuristic(jx, jy, to);
+        workspace.pushOpen(newGCost + hCost, hCost, jumpIndex);
+        hooks.push(state == State::kOpen, workspace.openSize());
+      }
+    }
+
+    hooks.end(workspace);
+    return false;
+  }
+
+private:
+  const gridmap::OccupancyGrid *grid;
+  bool bitScan;
+
+  int32_t indexOf(int x, int y) const {
+    return static_cast<int32_t>(grid->index(x, y));
+  }
+
+  bool passable(int x, int y) const { return grid->isPassable(x, y); }
+
+  static float distance(int ax, int ay, int bx, int by) {
+    const int dx = std::abs(ax - bx);
+    const int dy = std::abs(ay - by);
+    const int diagonal = std::min(dx, dy);
+    return static_cast<float>(std::max(dx, dy) - diagonal) + static_cast<float>(diagonal) * std::sqrt(2.0f);
+  }
+
+  static float heuristic(int x, int y, const Point &goal) {
+    return OctileHeuristic()(Point(x, y), goal);
+  }
+
+  static int sign(int v) { return (v > 0) - (v < 0); }
+
+  /// Directions worth jumping to from (x, y), given how the search arrived there.
+  int prunedDirections(int x, int y, int32_t parent, int (&out)[8][2]) const {
+    int count = 0;
+    auto add = [&](int dx, int dy) {
+      out[count][0] = dx;
+      out[count][1] = dy;
+      ++count;
+    };
+
+    if (parent < 0) {
+      for (int dy = -1; dy <= 1; ++dy)
+        for (int dx = -1; dx <= 1; ++dx)
+          if (dx != 0 || dy != 0) add(dx, dy);
+      return count;
+    }
+
+    const int width = grid->width();
+    const int dx = sign(x - parent % width);
+    const int dy = sign(y - parent / width);
+
+    if (dx != 0 && dy != 0) {
+      add(dx, 0);
+      add(0, dy);
+      add(dx, dy);
+      if (!passable(x - dx, y)) add(-dx, dy);
+      if (!passable(x, y - dy)) add(dx, -dy);
+    } else if (dx != 0) {
+      add(dx, 0);
+      if (!passable(x, y + 1)) add(dx, 1);
+      if (!passable(x, y - 1)) add(dx, -1);
+    } else {
+      add(0, dy);
+      if (!passable(x + 1, y)) add(1, dy);
+      if (!passable(x - 1, y)) add(-1, dy);
+    }
+    return count;
+  }
+
+  /// Follows direction (dx, dy) from (x, y) to the next jump point, if any.
+  bool jump(int x, int y, int dx, int dy, const Point &goal, int &jx, int &jy) const {
+    if (dx != 0 && dy != 0) {
+      for (;;) {
+        x += dx;
+        y += dy;
+        if (!passable(x, y)) return false;
+        if ((x == goal.x && y == goal.y) ||
+            (passable(x - dx, y + dy) && !passable(x - dx, y)) ||
+            (passable(x + dx, y - dy) && !passable(x, y - dy))) {
+          jx = x;
+          jy = y;
+          return true;
+        }
+        int sx, sy;
+        if (jumpStraight(x, y, dx, 0, goal, sx, sy) || jumpStraight(x, y, 0, dy, goal, sx, sy)) {
+          jx = x;
+          jy = y;
+          return true;
+        }
+      }
+    }
+    return jumpStraight(x, y, dx, dy, goal, jx, jy);
+  }
+
+  bool jumpStraight(int x, int y, int dx, int dy, const Point &goal, int &jx, int &jy) const {
+    if (dy == 0 && bitScan) {
+      jy = y;
+      return dx > 0 ? scanEast(x, y, goal, jx) : scanWest(x, y, goal, jx);
+    }
+    for (;;) {
+      x += dx;
+      y += dy;
+      if (!passable(x, y)) return false;
+      if (x == goal.x && y == goal.y) break;
+      if (dx != 0) {
+        if ((passable(x + dx, y + 1) && !passable(x, y + 1)) ||
+            (passable(x + dx, y - 1) && !passable(x, y - 1))) break;
+      } else {
+        if ((passable(x + 1, y + dy) && !passable(x + 1, y)) ||
+            (passable(x - 1, y + dy) && !passable(x - 1, y))) break;
+      }
+    }
+    jx = x;
+    jy = y;
+    return true;
+  }
+
+  /// Bit-scan horizontal jump to the east; stops at a forced neighbor, the goal or a wall.
+  bool scanEast(int x, int y, const Point &goal, int &jx) const {
+    for (int first = x + 1;; first += 64) {
+      const uint64_t row = grid->passableWindow(first, y);
+      const uint64_t up = grid->passableWindow(first, y + 1);
+      const uint64_t upAhead = grid->passableWindow(first + 1, y + 1);
+      const uint64_t down = grid->passableWindow(first, y - 1);
+      const uint64_t downAhead = grid->passableWindow(first + 1, y - 1);
+
+      uint64_t stop = ~row | (~up & upAhead) | (~down & downAhead);
+      if (goal.y == y && goal.x >= first && goal.x < first + 64) {
+        stop |= uint64_t{1} << (goal.x - first);
+      }
+      if (stop == 0) continue;
+
+      const int offset = __builtin_ctzll(stop);
+      if (((row >> offset) & 1u) == 0) return false;
+      jx = first + offset;
+      return true;
+    }
+  }
+
+  /// Mirror image of scanEast().
+  bool scanWest(int x, int y, const Point &goal, int &jx) const {
+    for (int last = x - 1;; last -= 64) {
+      const int first = last - 63;
+      const uint64_t row = grid->passableWindow(first, y);
+      const uint64_t up = grid->passableWindow(first, y + 1);
+      const uint64_t upAhead = grid->passableWindow(first - 1, y + 1);
+      const uint64_t down = grid->passableWindow(first, y - 1);
+      const uint64_t downAhead = grid->passableWindow(first - 1, y - 1);
+
+      uint64_t stop = ~row | (~up & upAhead) | (~down & downAhead);
+      if (goal.y == y && goal.x >= first && goal.x <= last) {
+        stop |= uint64_t{1} << (goal.x - first);
+      }
+      if (stop == 0) continue;
+
+      const int offset = 63 - __builtin_clzll(stop);
+      if (((row >> offset) & 1u) == 0) return false;
+      jx = first + offset;
+      return true;
+    }
+  }
+
+  /// Expands the jump point chain into one point per cell.
+  void buildPath(const SearchWorkspace &workspace, int32_t goalIndex, std::vector<Point> &path) const {
+    const int width = grid->width();
+    for (int32_t index = goalIndex; index != -1;) {
+      const int32_t parent = workspace.node(index).parent;
+      int x = index % width;
+      int y = index / width;
+      if (parent == -1) {
+        path.emplace_back(x, y);
+        break;
+      }
+      const int px = parent % width;
+      const int py = parent / width;
+      const int dx = sign(px - x);
+      const int dy = sign(py - y);
+      while (x != px || y != py) {
+        path.emplace_back(x, y);
+        if (x != px) x += dx;
+        if (y != py) y += dy;
+      }
+      index = parent;
+    }
+    std::reverse(path.begin(), path.end());
+  }
+};
+
+} // namespace astar
+
+#endif // JUMP_POINT_SEARCH_HPP_
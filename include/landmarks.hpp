@@ -0,0 +1,199 @@
+#ifndef LANDMARKS_HPP_
+#define LANDMARKS_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "a_star.hpp"
+#include "heuristics.hpp"
+#include "occupancy_grid.hpp"
+#include "search_workspace.hpp"
+#include "thread_pool.hpp"
+
+namespace astar {
+
+using gridmap::passabilityHash;
+
+/** Picks `count` free cells spread evenly along the map border.
+ *
+ * Landmarks behind the start or the goal give the tightest bounds, and on
+ * maps without a known query distribution the border is the best guess.
+ * For each of `count` points spaced evenly around the perimeter the nearest
+ * free cell is taken.
+ */
+inline std::vector<Point> selectLandmarks(const gridmap::OccupancyGrid &grid, size_t count) {
+  std::vector<Point> freeCells;
+  for (int y = 0; y < grid.height(); ++y) {
+    for (int x = 0; x < grid.width(); ++x) {
+      if (grid.isPassable(x, y)) freeCells.emplace_back(x, y);
+    }
+  }
+  std::vector<Point> landmarks;
+  if (freeCells.empty() || count == 0) return landmarks;
+
+  const int w = grid.width() - 1;
+  const int h = grid.height() - 1;
+  const double perimeter = 2.0 * (w + h);
+  for (size_t i = 0; i < count; ++i) {
+    double t = perimeter * static_cast<double>(i) / static_cast<double>(count);
+    Point target;
+    if (t < w) {
+      target = Point(static_cast<int>(t), 0);
+    } else if ((t -= w) < h) {
+      target = Point(w, static_cast<int>(t));
+    } else if ((t -= h) < w) {
+      target = Point(w - static_cast<int>(t), h);
+    } else {
+      t -= w;
+      target = Point(0, h - static_cast<int>(t));
+    }
+
+    Point best = freeCells.front();
+    long long bestDistance = std::numeric_limits<long long>::max();
+    for (const Point &cell : freeCells) {
+      const long long dx = cell.x - target.x;
+      const long long dy = cell.y - target.y;
+      const long long distance = dx * dx + dy * dy;
+      if (distance < bestDistance) {
+        bestDistance = distance;
+        best = cell;
+      }
+    }
+    if (std::find(landmarks.begin(), landmarks.end(), best) == landmarks.end()) landmarks.push_back(best);
+  }
+  return landmarks;
+}
+
+/// Floods the map from every landmark, one landmark per worker; if cancelled, the table has no landmarks.
+inline LandmarkTable buildLandmarkTable(const gridmap::OccupancyGrid &grid, size_t count,
+                                        ThreadPool &pool = ThreadPool::shared(),
+                                        const std::atomic<bool> *cancel = nullptr) {
+  LandmarkTable table;
+  table.width = grid.width();
+  table.height = grid.height();
+  table.mapHash = passabilityHash(grid);
+  table.landmarks = selectLandmarks(grid, count);
+  table.distances.assign(table.landmarks.size() * table.cellCount(), LandmarkHeuristic::kUnreachable);
+
+  const AStar planner(grid, Point(), Point());
+  std::vector<SearchWorkspace> workspaces(pool.size());
+  pool.parallelFor(table.landmarks.size(), [&](size_t l, unsigned worker) {
+    SearchWorkspace &workspace = workspaces[worker];
+    if (cancelRequested(cancel)) return;
+    planner.floodWithin(grid.bounds(), table.landmarks[l], workspace, cancel);
+    float *out = table.distances.data() + l * table.cellCount();
+    for (size_t i = 0; i < table.cellCount(); ++i) {
+      const int32_t cell = static_cast<int32_t>(i);
+      if (workspace.state(cell) == SearchWorkspace::State::kClosed) out[i] = workspace.node(cell).gCost;
+    }
+  });
+  if (cancelRequested(cancel)) {
+    table.landmarks.clear();
+    table.distances.clear();
+  }
+  return table;
+}
+
+namespace detail {
+
+constexpr uint32_t kLandmarkMagic = 0x544c4d47; // "GMLT"
+constexpr uint32_t kLandmarkFormat = 1;
+
+struct LandmarkFileHeader {
+  uint32_t magic;
+  uint32_t format;
+  int32_t width;
+  int32_t height;
+  uint64_t mapHash;
+  uint32_t landmarkCount;
+  uint32_t reserved;
+};
+
+} // namespace detail
+
+/// Writes the table in native byte order; returns false on I/O errors.
+inline bool saveLandmarkTable(const LandmarkTable &table, const std::string &path) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) return false;
+  const detail::LandmarkFileHeader header{detail::kLandmarkMagic, detail::kLandmarkFormat, table.width,
+                                          table.height, table.mapHash,
+                                          static_cast<uint32_t>(table.landmarks.size()), 0};
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  for (const Point &p : table.landmarks) {
+    const int32_t xy[2] = {p.x, p.y};
+    file.write(reinterpret_cast<const char *>(xy), sizeof(xy));
+  }
+  file.write(reinterpret_cast<const char *>(table.distanceData()),
+             static_cast<std::streamsize>(table.landmarks.size() * table.cellCount() * sizeof(float)));
+  return static_cast<bool>(file);
+}
+
+/// Reads a table written by saveLandmarkTable(); false if missing, truncated or of another format.
+inline bool loadLandmarkTable(const std::string &path, LandmarkTable &table) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) return false;
+  const std::streamoff fileSize = file.tellg();
+  file.seekg(0);
+  detail::LandmarkFileHeader header{};
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))) return false;
+  if (header.magic != detail::kLandmarkMagic || header.format != detail::kLandmarkFormat ||
+      header.width <= 0 || header.height <= 0) {
+    return false;
+  }
+  // Every landmark takes its position and one distance per cell; a count the file cannot hold is damage
+  const uint64_t landmarkBytes =
+    2 * sizeof(int32_t) + static_cast<uint64_t>(header.width) * static_cast<uint64_t>(header.height) * sizeof(float);
+  const uint64_t payloadBytes = static_cast<uint64_t>(fileSize) - sizeof(header);
+  if (header.landmarkCount > payloadBytes / landmarkBytes) return false;
+
+  LandmarkTable loaded;
+  loaded.width = header.width;
+  loaded.height = header.height;
+  loaded.mapHash = header.mapHash;
+  loaded.landmarks.reserve(header.landmarkCount);
+  for (uint32_t i = 0; i < header.landmarkCount; ++i) {
+    int32_t xy[2];
+    if (!file.read(reinterpret_cast<char *>(xy), sizeof(xy))) return false;
+    loaded.landmarks.emplace_back(xy[0], xy[1]);
+  }
+  loaded.distances.resize(loaded.landmarks.size() * loaded.cellCount());
+  if (!file.read(reinterpret_cast<char *>(loaded.distances.data()),
+                 static_cast<std::streamsize>(loaded.distances.size() * sizeof(float)))) {
+    return false;
+  }
+  table = std::move(loaded);
+  return true;
+}
+
+/** Loads the landmark table for `grid` from `cachePath`, or builds and saves it.
+ *
+ * A cached table is used only if it was built for a map with the same
+ * passability; otherwise it is rebuilt and overwritten. An empty
+ * `cachePath` disables the cache. Returns null if `cancel` stopped the
+ * build, and then writes nothing.
+ */
+inline std::shared_ptr<const LandmarkTable> loadOrBuildLandmarks(const gridmap::OccupancyGrid &grid, size_t count,
+                                                                 const std::string &cachePath = std::string(),
+                                                                 ThreadPool &pool = ThreadPool::shared(),
+                                                                 const std::atomic<bool> *cancel = nullptr) {
+  auto table = std::make_shared<LandmarkTable>();
+  if (!cachePath.empty() && loadLandmarkTable(cachePath, *table) && table->width == grid.width() &&
+      table->height == grid.height() && table->mapHash == passabilityHash(grid)) {
+    return table;
+  }
+  *table = buildLandmarkTable(grid, count, pool, cancel);
+  if (cancelRequested(cancel)) return nullptr;
+  if (!cachePath.empty()) saveLandmarkTable(*table, cachePath);
+  return table;
+}
+
+} // namespace astar
+
+#endif // LANDMARKS_HPP_
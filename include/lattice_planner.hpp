@@ -0,0 +1,458 @@
+#ifndef LATTICE_PLANNER_HPP_
+#define LATTICE_PLANNER_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "flow_field.hpp"
+#include "occupancy_grid.hpp"
+#include "open_list.hpp"
+#include "path_smoothing.hpp"
+#include "point.hpp"
+#include "search_stats.hpp"
+#include "search_workspace.hpp"
+
+namespace astar {
+
+/// Vehicle and search settings of a LatticePlanner; lengths are in cells.
+struct LatticeParams {
+  float turnRadius = 2.0f;         // Tightest turn the vehicle can drive
+  float length = 2.0f;             // Footprint along the heading, centered on the pose
+  float width = 1.0f;              // Footprint across the heading
+  float turnCost = 1.1f;           // Cost factor of turning primitives, so straight runs are preferred
+  float reverseCost = 3.0f;        // Cost factor of backing up; 0 disables reversing
+  int goalTolerance = 1;           // Cells in x and y the path may end from the goal, at the goal heading
+  float heuristicWeight = 1.2f;    // Factor on the 2-D cost-to-goal, see LatticePlanner
+  size_t maxExpansions = 1u << 21; // A search that expands more states gives up
+};
+
+/// Cells dx..dx+length-1 of row dy, relative to the cell a motion starts from.
+struct FootprintSpan {
+  int32_t dy;
+  int32_t dx;
+  int32_t length;
+};
+
+/// One precomputed motion from a lattice state: cell offset, heading change, cost and swept cells.
+struct MotionPrimitive {
+  int dx = 0;
+  int dy = 0;
+  int endHeading = 0;
+  float cost = 0.0f;
+  bool reverse = false;
+  std::vector<PathPose> poses;      // Relative to the start cell's center, every quarter cell; the last is the end pose
+  std::vector<FootprintSpan> swept; // Cells the footprint covers along `poses`, so not at the start pose
+};
+
+/** Motion primitives and footprint tables for a 16-heading state lattice.
+ *
+ * Headings point along the integer vectors (1,0), (2,1), (1,1), (1,2), ...,
+ * so every primitive ends exactly on a cell center at a lattice heading.
+ * From each heading there is a straight step, a left and a right turn to
+ * the neighboring heading and, if enabled, a straight step backwards. A
+ * turn is the shortest cubic Hermite curve to an integer end point whose
+ * curvature stays within 1/turnRadius and whose heading turns one way only.
+ *
+ * The footprint is rasterized once per heading and once along every
+ * primitive, into row spans of the cells it overlaps, so a collision check
+ * at search time tests packed passability words, 64 cells at a time.
+ * Depends only on the parameters, not on the map.
+ */
+class MotionPrimitiveTable {
+public:
+  static constexpr int kHeadings = 16;
+
+  explicit MotionPrimitiveTable(const LatticeParams &params_ = LatticeParams()) : params(params_) {
+    for (int h = 0; h < kHeadings; ++h) {
+      footprints[h] = rasterize({{0.0f, 0.0f, headingAngle(h)}});
+      addStraight(h, false);
+      if (params.reverseCost > 0.0f) addStraight(h, true);
+      addTurn(h, (h + 1) % kHeadings);
+      addTurn(h, (h + kHeadings - 1) % kHeadings);
+    }
+  }
+
+  /// Direction of lattice heading `h` as an integer cell step.
+  static Point headingStep(int h) {
+    static constexpr int kSteps[kHeadings][2] = {{1, 0},  {2, 1},   {1, 1},   {1, 2},  {0, 1},  {-1, 2}, {-1, 1}, {-2, 1},
+                                                 {-1, 0}, {-2, -1}, {-1, -1}, {-1, -2}, {0, -1}, {1, -2}, {1, -1}, {2, -1}};
+    return Point(kSteps[h][0], kSteps[h][1]);
+  }
+
+  /// Angle of lattice heading `h` in radians, in cell coordinates.
+  static float headingAngle(int h) {
+    const Point step = headingStep(h);
+    return std::atan2(static_cast<float>(step.y), static_cast<float>(step.x));
+  }
+
+  /// The lattice heading closest to `theta`.
+  static int nearestHeading(float theta) {
+    int best = 0;
+    float bestTurn = std::numeric_limits<float>::infinity();
+    for (int h = 0; h < kHeadings; ++h) {
+      const float turn = std::fabs(std::remainder(theta - headingAngle(h), 2.0f * kPi));
+      if (turn < bestTurn) {
+        bestTurn = turn;
+        best = h;
+      }
+    }
+    return best;
+  }
+
+  const std::vector<MotionPrimitive> &primitives(int heading) const { return table[heading]; }
+  /// Cells a vehicle standing on a cell center at lattice heading `heading` covers.
+  const std::vector<FootprintSpan> &footprint(int heading) const { return footprints[heading]; }
+  const LatticeParams &parameters() const { return params; }
+
+  size_t primitiveCount() const {
+    size_t count = 0;
+    for (const auto &primitives : table) count += primitives.size();
+    return count;
+  }
+
+  /// Whether every cell of `spans`, placed relative to (x, y), is inside the grid and passable.
+  static bool isFree(const gridmap::OccupancyGrid &grid, int x, int y, const std::vector<FootprintSpan> &spans) {
+    for (const FootprintSpan &span : spans) {
+      const int row = y + span.dy;
+      const int first = x + span.dx;
+      if (row < 0 || row >= grid.height() || first < 0 || first + span.length > grid.width()) return false;
+      for (int offset = 0; offset < span.length; offset += 64) {
+        const int count = std::min(64, span.length - offset);
+        const uint64_t wanted = count == 64 ? ~uint64_t{0} : (uint64_t{1} << count) - 1;
+        if ((grid.passableWindow(first + offset, row) & wanted) != wanted) return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  static constexpr float kPi = 3.14159265358979f;
+  static constexpr float kSampleStep = 0.25f;
+
+  LatticeParams params;
+  std::vector<MotionPrimitive> table[kHeadings];
+  std::vector<FootprintSpan> footprints[kHeadings];
+
+  void addStraight(int h, bool reverse) {
+    const Point step = headingStep(h);
+    const int sign = reverse ? -1 : 1;
+    const float length = std::hypot(static_cast<float>(step.x), static_cast<float>(step.y));
+    const int samples = static_cast<int>(std::ceil(length / kSampleStep));
+    MotionPrimitive primitive;
+    primitive.dx = sign * step.x;
+    primitive.dy = sign * step.y;
+    primitive.endHeading = h;
+    primitive.cost = length * (reverse ? params.reverseCost : 1.0f);
+    primitive.reverse = reverse;
+    for (int k = 1; k <= samples; ++k) {
+      const float t = static_cast<float>(k) / static_cast<float>(samples);
+      primitive.poses.push_back({t * primitive.dx, t * primitive.dy, headingAngle(h)});
+    }
+    primitive.swept = rasterize(primitive.poses);
+    table[h].push_back(std::move(primitive));
+  }
+
+  /// The shortest admissible curve from heading `from` to heading `to`; none if no end point within reach works.
+  void addTurn(int from, int to) {
+    const float a0 = headingAngle(from);
+    const float turn = std::remainder(headingAngle(to) - a0, 2.0f * kPi);
+    const float a1 = a0 + turn;
+    const float u0x = std::cos(a0), u0y = std::sin(a0);
+    const float u1x = std::cos(a1), u1y = std::sin(a1);
+    const int reach = static_cast<int>(std::ceil(2.0f * params.turnRadius)) + 3;
+    constexpr int kProbe = 64;
+
+    MotionPrimitive best;
+    best.cost = std::numeric_limits<float>::infinity();
+    for (int ey = -reach; ey <= reach; ++ey) {
+      for (int ex = -reach; ex <= reach; ++ex) {
+        const float chord = std::hypot(static_cast<float>(ex), static_cast<float>(ey));
+        if (chord == 0.0f || ex * u0x + ey * u0y <= 0.0f || ex * u1x + ey * u1y <= 0.0f) continue;
+        // p(t) with p0 = 0, p1 = (ex, ey) and both tangents as long as the chord
+        auto position = [&](float t, float &x, float &y) {
+          const float h10 = t * t * t - 2.0f * t * t + t;
+          const float h01 = 3.0f * t * t - 2.0f * t * t * t;
+          const float h11 = t * t * t - t * t;
+          x = chord * (h10 * u0x + h11 * u1x) + h01 * ex;
+          y = chord * (h10 * u0y + h11 * u1y) + h01 * ey;
+        };
+        auto derivatives = [&](float t, float &dx, float &dy, float &ddx, float &ddy) {
+          const float d10 = 3.0f * t * t - 4.0f * t + 1.0f;
+          const float d01 = 6.0f * t - 6.0f * t * t;
+          const float d11 = 3.0f * t * t - 2.0f * t;
+          dx = chord * (d10 * u0x + d11 * u1x) + d01 * ex;
+          dy = chord * (d10 * u0y + d11 * u1y) + d01 * ey;
+          const float s10 = 6.0f * t - 4.0f;
+          const float s01 = 6.0f - 12.0f * t;
+          const float s11 = 6.0f * t - 2.0f;
+          ddx = chord * (s10 * u0x + s11 * u1x) + s01 * ex;
+          ddy = chord * (s10 * u0y + s11 * u1y) + s01 * ey;
+        };
+
+        bool admissible = true;
+        float length = 0.0f;
+        float px = 0.0f, py = 0.0f;
+        for (int k = 0; k <= kProbe && admissible; ++k) {
+          const float t = static_cast<float>(k) / kProbe;
+          float dx, dy, ddx, ddy;
+          derivatives(t, dx, dy, ddx, ddy);
+          const float speed = std::hypot(dx, dy);
+          const float bend = dx * ddy - dy * ddx; // Curvature times speed cubed, signed
+          if (speed < 1e-4f || std::fabs(bend) > speed * speed * speed / params.turnRadius ||
+              bend * turn < -1e-4f * speed * speed * speed) {
+            admissible = false;
+          }
+          float x, y;
+          position(t, x, y);
+          length += std::hypot(x - px, y - py);
+          px = x;
+          py = y;
+        }
+        if (!admissible || length >= best.cost) continue;
+
+        best.dx = ex;
+        best.dy = ey;
+        best.cost = length;
+        best.poses.clear();
+        const int samples = static_cast<int>(std::ceil(length / kSampleStep));
+        for (int k = 1; k <= samples; ++k) {
+          const float t = static_cast<float>(k) / static_cast<float>(samples);
+          float x, y, dx, dy, ddx, ddy;
+          position(t, x, y);
+          derivatives(t, dx, dy, ddx, ddy);
+          best.poses.push_back({x, y, std::atan2(dy, dx)});
+        }
+      }
+    }
+    if (best.poses.empty()) return;
+    best.poses.back() = {static_cast<float>(best.dx), static_cast<float>(best.dy), headingAngle(to)};
+    best.endHeading = to;
+    best.cost *= params.turnCost;
+    best.swept = rasterize(best.poses);
+    table[from].push_back(std::move(best));
+  }
+
+  /** Row spans of the cells the footprint overlaps at any of `poses`.
+   *
+   * Poses are relative to the center of cell (0, 0). A cell counts if the
+   * footprint rectangle and the cell's square overlap with positive area,
+   * found with a separating-axis test.
+   */
+  std::vector<FootprintSpan> rasterize(const std::vector<PathPose> &poses) const {
+    constexpr float kEpsilon = 1e-4f;
+    const float halfLength = 0.5f * params.length;
+    const float halfWidth = 0.5f * params.width;
+    std::vector<std::pair<int, int>> cells; // (dy, dx)
+    for (const PathPose &pose : poses) {
+      const float cx = 0.5f + pose.x;
+      const float cy = 0.5f + pose.y;
+      const float c = std::cos(pose.theta);
+      const float s = std::sin(pose.theta);
+      const float extentX = std::fabs(c) * halfLength + std::fabs(s) * halfWidth;
+      const float extentY = std::fabs(s) * halfLength + std::fabs(c) * halfWidth;
+      const float squareExtent = 0.5f * (std::fabs(c) + std::fabs(s)); // Half the square's projection on the rectangle's axes
+      for (int y = static_cast<int>(std::floor(cy - extentY)); y <= static_cast<int>(std::floor(cy + extentY)); ++y) {
+        for (int x = static_cast<int>(std::floor(cx - extentX)); x <= static_cast<int>(std::floor(cx + extentX)); ++x) {
+          if (cx + extentX <= x + kEpsilon || cx - extentX >= x + 1 - kEpsilon) continue;
+          if (cy + extentY <= y + kEpsilon || cy - extentY >= y + 1 - kEpsilon) continue;
+          const float ox = x + 0.5f - cx;
+          const float oy = y + 0.5f - cy;
+          if (std::fabs(ox * c + oy * s) >= halfLength + squareExtent - kEpsilon) continue;
+          if (std::fabs(-ox * s + oy * c) >= halfWidth + squareExtent - kEpsilon) continue;
+          cells.emplace_back(y, x);
+        }
+      }
+    }
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+    std::vector<FootprintSpan> spans;
+    for (const auto &cell : cells) {
+      if (!spans.empty() && spans.back().dy == cell.first && spans.back().dx + spans.back().length == cell.second) {
+        ++spans.back().length;
+      } else {
+        spans.push_back({cell.first, cell.second, 1});
+      }
+    }
+    return spans;
+  }
+};
+
+/** Pose-to-pose search over (x, y, heading) for vehicles that cannot turn in place.
+ *
+ * A* over the states of a MotionPrimitiveTable lattice: a state is a cell
+ * and one of 16 headings, its successors are the primitives of its
+ * heading whose swept footprint is free. The heuristic is the cost to the
+ * goal cell in a FlowField, the exact 2-D cost around obstacles, taken
+ * from a FlowFieldCache so repeated queries to one goal on an unchanged
+ * map reuse it. Cells the field cannot reach are never opened. The field
+ * knows nothing of headings, so at weight 1 the search fans out over every
+ * heading of the cells near the path; the default weight of 1.2 expands
+ * about a tenth as many states on the 500x500 maze for paths of nearly the
+ * same length, and bounds their cost to about that factor above the
+ * lattice optimum (the field's 8-connected costs can exceed the straight
+ * primitives by up to 8% more).
+ *
+ * States are kept in the caller's SearchWorkspace, indexed by cell times
+ * 16 plus heading. Start and goal headings are snapped to the nearest
+ * lattice heading. The result is the sequence of primitive poses in cell
+ * coordinates, see toWorld(), and the cells they pass through.
+ */
+class LatticePlanner {
+public:
+  static constexpr int kHeadings = MotionPrimitiveTable::kHeadings;
+
+  LatticePlanner(const gridmap::OccupancyGrid &grid_, FlowFieldCache &flowFields_,
+                 const LatticeParams &params = LatticeParams()) :
+    grid(grid_), flowFields(flowFields_), primitives(params) {}
+
+  bool findPath(const Point &from, float fromHeading, const Point &to, float toHeading, SearchWorkspace &workspace,
+                std::vector<Point> &path, std::vector<PathPose> *poses = nullptr,
+                const std::atomic<bool> *cancel = nullptr) {
+    NoSearchHooks hooks;
+    return findPath(from, fromHeading, to, toHeading, workspace, path, poses, hooks, cancel);
+  }
+
+  /// findPath() reporting to `hooks`, which see the cell of every expanded state.
+  template <typename Hooks>
+  bool findPath(const Point &from, float fromHeading, const Point &to, float toHeading, SearchWorkspace &workspace,
+                std::vector<Point> &path, std::vector<PathPose> *poses, Hooks &hooks,
+                const std::atomic<bool> *cancel = nullptr) {
+    using State = SearchWorkspace::State;
+    path.clear();
+    if (poses != nullptr) poses->clear();
+    if (!grid.inBounds(from.x, from.y) || !grid.inBounds(to.x, to.y)) return false;
+
+    hooks.begin(workspace);
+    const int width = grid.width();
+    workspace.prepare(width * kHeadings, grid.height());
+    const LatticeParams &params = primitives.parameters();
+    const int goalHeading = MotionPrimitiveTable::nearestHeading(toHeading);
+    const FlowField &field = flowFields.field(to);
+    if (!field.reachable(from) || !goalFits(field, to, goalHeading)) {
+      hooks.end(workspace);
+      return false;
+    }
+
+    IndexedHeapOpenList<4> open(workspace);
+    const int32_t startState = stateIndex(from.x, from.y, MotionPrimitiveTable::nearestHeading(fromHeading));
+    workspace.open(startState, 0.0f, -1);
+    const float startH = params.heuristicWeight * field.cost(from);
+    open.push(startH, startH, startState);
+    hooks.push(false, open.size());
+    hooks.phase(SearchPhase::kExpand);
+
+    while (!open.empty()) {
+      const SearchWorkspace::OpenEntry entry = open.pop();
+      SearchWorkspace::NodeRecord &current = workspace.node(entry.index);
+      current.state = State::kClosed;
+      workspace.countExpansion();
+      const int32_t cell = entry.index / kHeadings;
+      const int heading = entry.index % kHeadings;
+      hooks.expand(cell);
+      if (cancelRequested(cancel, workspace.expanded()) || workspace.expanded() > params.maxExpansions) {
+        hooks.end(workspace);
+        return false;
+      }
+
+      const int cx = cell % width;
+      const int cy = cell / width;
+      if (heading == goalHeading && std::abs(cx - to.x) <= params.goalTolerance &&
+          std::abs(cy - to.y) <= params.goalTolerance) {
+        hooks.phase(SearchPhase::kPath);
+        tracePath(entry.index, workspace, path, poses);
+        hooks.end(workspace);
+        return true;
+      }
+
+      const float gCost = current.gCost;
+      for (const MotionPrimitive &primitive : primitives.primitives(heading)) {
+        const int nx = cx + primitive.dx;
+        const int ny = cy + primitive.dy;
+        if (!grid.inBounds(nx, ny)) continue;
+        const float remaining = field.cost(nx, ny);
+        if (remaining == FlowField::kUnreachable) continue;
+        const int32_t next = stateIndex(nx, ny, primitive.endHeading);
+        const float newGCost = gCost + primitive.cost;
+        const State state = workspace.state(next);
+        if (state == State::kClosed) continue;
+        if (state == State::kOpen && workspace.node(next).gCost <= newGCost) continue;
+        if (!MotionPrimitiveTable::isFree(grid, cx, cy, primitive.swept)) continue;
+
+        workspace.open(next, newGCost, entry.index);
+        const float hCost = params.heuristicWeight * remaining;
+        open.push(newGCost + hCost, hCost, next);
+        hooks.push(state == State::kOpen, open.size());
+      }
+    }
+
+    hooks.end(workspace);
+    return false;
+  }
+
+  const MotionPrimitiveTable &primitiveTable() const { return primitives; }
+
+private:
+  const gridmap::OccupancyGrid &grid;
+  FlowFieldCache &flowFields;
+  MotionPrimitiveTable primitives;
+  std::vector<int32_t> states;
+
+  int32_t stateIndex(int x, int y, int heading) const {
+    return static_cast<int32_t>(grid.index(x, y)) * kHeadings + heading;
+  }
+
+  /// Whether the vehicle fits at the goal heading somewhere within the tolerance; saves a hopeless search.
+  bool goalFits(const FlowField &field, const Point &goal, int heading) const {
+    const int tolerance = primitives.parameters().goalTolerance;
+    for (int y = goal.y - tolerance; y <= goal.y + tolerance; ++y) {
+      for (int x = goal.x - tolerance; x <= goal.x + tolerance; ++x) {
+        if (!grid.inBounds(x, y) || !field.reachable(Point(x, y))) continue;
+        if (MotionPrimitiveTable::isFree(grid, x, y, primitives.footprint(heading))) return true;
+      }
+    }
+    return false;
+  }
+
+  /// Walks the parents back from `last` and expands each step into the poses of the primitive that made it.
+  void tracePath(int32_t last, const SearchWorkspace &workspace, std::vector<Point> &path,
+                 std::vector<PathPose> *poses) {
+    states.clear();
+    for (int32_t state = last; state != -1; state = workspace.node(state).parent) states.push_back(state);
+    std::reverse(states.begin(), states.end());
+
+    const int width = grid.width();
+    auto emit = [&](float x, float y, float theta) {
+      const Point cell(static_cast<int>(std::floor(x)), static_cast<int>(std::floor(y)));
+      if (path.empty() || path.back() != cell) path.push_back(cell);
+      if (poses != nullptr) poses->push_back({x, y, theta});
+    };
+    const int32_t first = states.front() / kHeadings;
+    emit(first % width + 0.5f, first / width + 0.5f, MotionPrimitiveTable::headingAngle(states.front() % kHeadings));
+
+    for (size_t i = 1; i < states.size(); ++i) {
+      const int32_t from = states[i - 1];
+      const int32_t to = states[i];
+      const int cx = from / kHeadings % width;
+      const int cy = from / kHeadings / width;
+      const float gap = workspace.node(to).gCost - workspace.node(from).gCost;
+      // The primitive that ends on the state; if two do, the one whose cost matches the step
+      const MotionPrimitive *used = nullptr;
+      for (const MotionPrimitive &primitive : primitives.primitives(from % kHeadings)) {
+        if (stateIndex(cx + primitive.dx, cy + primitive.dy, primitive.endHeading) != to) continue;
+        if (used == nullptr || std::fabs(primitive.cost - gap) < std::fabs(used->cost - gap)) used = &primitive;
+      }
+      if (used == nullptr) continue;
+      for (const PathPose &pose : used->poses) emit(cx + 0.5f + pose.x, cy + 0.5f + pose.y, pose.theta);
+    }
+  }
+};
+
+} // namespace astar
+
+#endif // LATTICE_PLANNER_HPP_
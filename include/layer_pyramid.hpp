@@ -0,0 +1,135 @@
+#ifndef LAYER_PYRAMID_HPP_
+#define LAYER_PYRAMID_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "occupancy_grid.hpp"
+
+namespace gridmap {
+
+/** Mip pyramid of one byte per cell.
+ *
+ * Level 0 holds one value per cell; every further level halves both
+ * dimensions and keeps the maximum of each 2x2 block, so obstacles and cost
+ * peaks stay visible when zoomed out. Levels are added until the top one
+ * fits into `topSize` x `topSize`.
+ *
+ * For maps streamed from disk level 0 can be left out: the levels above
+ * are then computed straight from the cell values, and level 0 has to be
+ * read from the source.
+ */
+class LayerPyramid {
+public:
+  /// Cells are read in blocks of this size, so a tiled source is read one tile at a time.
+  static constexpr int kBuildBlock = 256;
+
+  template <typename ValueFn>
+  void build(int width, int height, int topSize, ValueFn &&value, bool keepBase = true) {
+    levelSizes.clear();
+    levelData.clear();
+    base = keepBase;
+    int w = width;
+    int h = height;
+    for (;;) {
+      levelSizes.push_back({w, h});
+      const bool stored = keepBase || !levelData.empty();
+      levelData.emplace_back(stored ? static_cast<size_t>(w) * static_cast<size_t>(h) : 0, 0);
+      if (w <= topSize && h <= topSize) break;
+      w = (w + 1) / 2;
+      h = (h + 1) / 2;
+    }
+    if (!keepBase && levelData.size() == 1) {
+      // The map fits the top level as is; it needs a level above to be drawn without level 0
+      levelSizes.push_back({(width + 1) / 2, (height + 1) / 2});
+      levelData.emplace_back(static_cast<size_t>(levelSizes[1].first) * static_cast<size_t>(levelSizes[1].second), 0);
+    }
+    for (int y = 0; y < height; y += kBuildBlock) {
+      for (int x = 0; x < width; x += kBuildBlock) update({x, y, x + kBuildBlock, y + kBuildBlock}, value);
+    }
+  }
+
+  /// Recomputes level 0 inside `cells` and propagates the change upwards.
+  template <typename ValueFn>
+  void update(const CellRect &cells, ValueFn &&value) {
+    if (levelData.empty()) return;
+    CellRect rect = cells.intersected({0, 0, levelSizes[0].first, levelSizes[0].second});
+    if (rect.empty()) return;
+
+    size_t level = 1;
+    if (base) {
+      std::vector<uint8_t> &row0 = levelData[0];
+      const int baseWidth = levelSizes[0].first;
+      for (int y = rect.y0; y < rect.y1; ++y) {
+        uint8_t *row = row0.data() + static_cast<size_t>(y) * baseWidth;
+        for (int x = rect.x0; x < rect.x1; ++x) row[x] = value(x, y);
+      }
+    } else {
+      // Level 1 straight from the cells
+      rect = {rect.x0 / 2, rect.y0 / 2, (rect.x1 + 1) / 2, (rect.y1 + 1) / 2};
+      std::vector<uint8_t> &parent = levelData[1];
+      const int parentWidth = levelSizes[1].first;
+      for (int y = rect.y0; y < rect.y1; ++y) {
+        for (int x = rect.x0; x < rect.x1; ++x) {
+          uint8_t v = 0;
+          for (int dy = 0; dy < 2; ++dy) {
+            const int cy = 2 * y + dy;
+            if (cy >= levelSizes[0].second) break;
+            for (int dx = 0; dx < 2; ++dx) {
+              const int cx = 2 * x + dx;
+              if (cx >= levelSizes[0].first) break;
+              v = std::max(v, static_cast<uint8_t>(value(cx, cy)));
+            }
+          }
+          parent[static_cast<size_t>(y) * parentWidth + x] = v;
+        }
+      }
+      level = 2;
+    }
+
+    for (; level < levelData.size(); ++level) {
+      rect = {rect.x0 / 2, rect.y0 / 2, (rect.x1 + 1) / 2, (rect.y1 + 1) / 2};
+      const int childWidth = levelSizes[level - 1].first;
+      const int childHeight = levelSizes[level - 1].second;
+      const std::vector<uint8_t> &child = levelData[level - 1];
+      std::vector<uint8_t> &parent = levelData[level];
+      const int parentWidth = levelSizes[level].first;
+      for (int y = rect.y0; y < rect.y1; ++y) {
+        for (int x = rect.x0; x < rect.x1; ++x) {
+          uint8_t v = 0;
+          for (int dy = 0; dy < 2; ++dy) {
+            const int cy = 2 * y + dy;
+            if (cy >= childHeight) break;
+            for (int dx = 0; dx < 2; ++dx) {
+              const int cx = 2 * x + dx;
+              if (cx >= childWidth) break;
+              v = std::max(v, child[static_cast<size_t>(cy) * childWidth + cx]);
+            }
+          }
+          parent[static_cast<size_t>(y) * parentWidth + x] = v;
+        }
+      }
+    }
+  }
+
+  int levels() const { return static_cast<int>(levelData.size()); }
+  int levelWidth(int level) const { return levelSizes[level].first; }
+  int levelHeight(int level) const { return levelSizes[level].second; }
+
+  /// False if level 0 is not stored and has to be read from the source.
+  bool hasBase() const { return base; }
+
+  uint8_t value(int level, int x, int y) const {
+    return levelData[level][static_cast<size_t>(y) * levelSizes[level].first + x];
+  }
+
+private:
+  std::vector<std::pair<int, int>> levelSizes;
+  std::vector<std::vector<uint8_t>> levelData;
+  bool base = true;
+};
+
+} // namespace gridmap
+
+#endif // LAYER_PYRAMID_HPP_
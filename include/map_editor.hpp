@@ -0,0 +1,192 @@
+#ifndef MAP_EDITOR_HPP_
+#define MAP_EDITOR_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "occupancy_grid.hpp"
+
+namespace gridmap {
+
+/// Consecutive cells (row-major) that one edit changed from the same value to the same value.
+struct CellRun {
+  int32_t first;
+  int32_t length;
+  int8_t before;
+  int8_t after;
+};
+
+/// The cells one brush stroke changed, run-length encoded.
+struct MapEdit {
+  CellRect bounds;
+  std::vector<CellRun> runs;
+
+  size_t bytes() const { return sizeof(MapEdit) + runs.capacity() * sizeof(CellRun); }
+};
+
+/** Brush editing of an OccupancyGrid with undo and redo.
+ *
+ * A stroke runs from beginStroke() to endStroke(); paint() and paintLine()
+ * set every cell within the brush radius to one value through
+ * OccupancyGrid::setValue(), so the change journal sees each cell and
+ * journal-driven consumers (costmap, HPA*, D* Lite, the component index)
+ * update only what the stroke touched. A finished stroke is kept as a
+ * MapEdit of runs of old and new values, which for a brush costs a few
+ * runs per row instead of a copy of the map. The undo history is trimmed
+ * from the oldest end to `undoBudget` bytes.
+ *
+ * Every change also grows the dirty rectangle, which takeDirty() hands to
+ * the renderer so it re-rasterizes only the tiles under it. The grid must
+ * not be read by other threads while it is edited.
+ */
+class MapEditor {
+public:
+  static constexpr size_t kDefaultUndoBudget = 8u << 20;
+
+  explicit MapEditor(OccupancyGrid &grid_, size_t undoBudget_ = kDefaultUndoBudget) :
+    grid(grid_), undoBudget(undoBudget_) {}
+
+  void beginStroke() {
+    if (stroking) endStroke();
+    stroking = true;
+    strokeCells.clear();
+    strokeBounds = CellRect();
+  }
+
+  /// Cells whose centers lie within `radius` of the point (x, y), in cell coordinates.
+  CellRect paint(float x, float y, float radius, int8_t value) { return paintLine(x, y, x, y, radius, value); }
+
+  /// Cells whose centers lie within `radius` of the segment from (ax, ay) to (bx, by), so fast drags leave no gaps.
+  CellRect paintLine(float ax, float ay, float bx, float by, float radius, int8_t value) {
+    if (!stroking) beginStroke();
+    const CellRect box = CellRect{static_cast<int>(std::floor(std::min(ax, bx) - radius)),
+                                  static_cast<int>(std::floor(std::min(ay, by) - radius)),
+                                  static_cast<int>(std::floor(std::max(ax, bx) + radius)) + 1,
+                                  static_cast<int>(std::floor(std::max(ay, by) + radius)) + 1}
+                           .intersected(grid.bounds());
+    const float dx = bx - ax;
+    const float dy = by - ay;
+    const float lengthSquared = dx * dx + dy * dy;
+    CellRect changed;
+    for (int y = box.y0; y < box.y1; ++y) {
+      for (int x = box.x0; x < box.x1; ++x) {
+        const float px = x + 0.5f - ax;
+        const float py = y + 0.5f - ay;
+        const float t = lengthSquared > 0.0f ? std::clamp((px * dx + py * dy) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+        const float ex = px - t * dx;
+        const float ey = py - t * dy;
+        if (ex * ex + ey * ey > radius * radius) continue;
+        const int8_t before = grid.value(x, y);
+        if (before == value) continue;
+        strokeCells.push_back({static_cast<int32_t>(grid.index(x, y)), before, value});
+        grid.setValue(x, y, value);
+        changed = changed.united({x, y, x + 1, y + 1});
+      }
+    }
+    strokeBounds = strokeBounds.united(changed);
+    dirty = dirty.united(changed);
+    return changed;
+  }
+
+  /// Files the stroke on the undo stack; a stroke that changed nothing is dropped.
+  void endStroke() {
+    if (!stroking) return;
+    stroking = false;
+    if (strokeCells.empty()) return;
+    // A cell painted twice in one stroke keeps its first old and its last new value
+    std::stable_sort(strokeCells.begin(), strokeCells.end(),
+                     [](const Change &a, const Change &b) { return a.index < b.index; });
+    MapEdit edit;
+    edit.bounds = strokeBounds;
+    for (size_t i = 0; i < strokeCells.size(); ++i) {
+      Change change = strokeCells[i];
+      while (i + 1 < strokeCells.size() && strokeCells[i + 1].index == change.index) change.after = strokeCells[++i].after;
+      if (change.before == change.after) continue;
+      if (!edit.runs.empty()) {
+        CellRun &last = edit.runs.back();
+        if (last.first + last.length == change.index && last.before == change.before && last.after == change.after) {
+          ++last.length;
+          continue;
+        }
+      }
+      edit.runs.push_back({change.index, 1, change.before, change.after});
+    }
+    if (edit.runs.empty()) return;
+    edit.runs.shrink_to_fit();
+    undoStack.push_back(std::move(edit));
+    undoBytes += undoStack.back().bytes();
+    redoStack.clear();
+    while (undoBytes > undoBudget && undoStack.size() > 1) {
+      undoBytes -= undoStack.front().bytes();
+      undoStack.pop_front();
+    }
+  }
+
+  bool canUndo() const { return !stroking && !undoStack.empty(); }
+  bool canRedo() const { return !stroking && !redoStack.empty(); }
+
+  /// Reverts the last stroke; returns the cells it restored.
+  CellRect undo() {
+    if (!canUndo()) return CellRect();
+    MapEdit edit = std::move(undoStack.back());
+    undoStack.pop_back();
+    undoBytes -= edit.bytes();
+    apply(edit, false);
+    redoStack.push_back(std::move(edit));
+    return redoStack.back().bounds;
+  }
+
+  /// Repeats the last undone stroke; returns the cells it changed.
+  CellRect redo() {
+    if (!canRedo()) return CellRect();
+    MapEdit edit = std::move(redoStack.back());
+    redoStack.pop_back();
+    apply(edit, true);
+    undoBytes += edit.bytes();
+    undoStack.push_back(std::move(edit));
+    return undoStack.back().bounds;
+  }
+
+  size_t undoDepth() const { return undoStack.size(); }
+  size_t redoDepth() const { return redoStack.size(); }
+  /// Memory held by the undo history.
+  size_t historyBytes() const { return undoBytes; }
+
+  /// Cells changed since the last call, for partial re-rendering; clears the region.
+  CellRect takeDirty() { return std::exchange(dirty, CellRect()); }
+
+private:
+  struct Change {
+    int32_t index;
+    int8_t before;
+    int8_t after;
+  };
+
+  OccupancyGrid &grid;
+  size_t undoBudget;
+  bool stroking = false;
+  std::vector<Change> strokeCells;
+  CellRect strokeBounds;
+  CellRect dirty;
+  std::deque<MapEdit> undoStack;
+  std::vector<MapEdit> redoStack;
+  size_t undoBytes = 0;
+
+  void apply(const MapEdit &edit, bool forward) {
+    const int width = grid.width();
+    for (const CellRun &run : edit.runs) {
+      const int8_t value = forward ? run.after : run.before;
+      for (int32_t i = run.first; i < run.first + run.length; ++i) grid.setValue(i % width, i / width, value);
+    }
+    dirty = dirty.united(edit.bounds);
+  }
+};
+
+} // namespace gridmap
+
+#endif // MAP_EDITOR_HPP_
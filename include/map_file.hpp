@@ -0,0 +1,273 @@
+#ifndef MAP_FILE_HPP_
+#define MAP_FILE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "costmap.hpp"
+#include "heuristics.hpp"
+#include "map_info.hpp"
+#include "occupancy_grid.hpp"
+
+namespace gridmap {
+
+/** Binary map file, opened with mmap.
+ *
+ * Layout, native byte order:
+ * - a fixed header with the map size, the map_server metadata and the
+ *   passability hash
+ * - a table of sections, each 64-byte aligned:
+ *   - the int8 probability layer
+ *   - the packed passability layer, guard bits included, exactly as
+ *     OccupancyGrid keeps it in memory
+ *   - optional: the clearance field, and the ALT landmarks and their
+ *     distance tables
+ *
+ * Opening maps the file privately and wraps the sections in place, so
+ * nothing is decoded or copied. Edits to the grid land in private pages and
+ * never reach the file.
+ */
+struct MapFile {
+  MapInfo info;
+  MapMetaData metaData{};
+  ClearanceField clearance;                                // distances is null if absent
+  std::shared_ptr<const astar::LandmarkTable> landmarks; // Null if absent
+};
+
+namespace detail {
+
+constexpr uint32_t kMapFileMagic = 0x50414d47; // "GMAP"
+constexpr uint32_t kMapFileFormat = 1;
+constexpr size_t kMapFileAlignment = 64;
+
+enum class MapSection : uint32_t {
+  kCells = 1,
+  kPassable = 2,
+  kClearance = 3,         // float per cell; `param` is the cap
+  kLandmarks = 4,         // int32 x, y per landmark
+  kLandmarkDistances = 5, // float per cell and landmark
+};
+
+struct MapFileHeader {
+  uint32_t magic;
+  uint32_t format;
+  int32_t width;
+  int32_t height;
+  float resolution;
+  float originX;
+  float originY;
+  float originYaw;
+  float occupiedThresh;
+  float freeThresh;
+  uint32_t negate;
+  uint32_t mode;
+  uint64_t mapHash;
+  uint32_t sectionCount;
+  uint32_t reserved;
+};
+
+struct MapSectionEntry {
+  uint32_t type;
+  float param;
+  uint64_t offset;
+  uint64_t size;
+};
+
+inline size_t alignedSize(size_t size) { return (size + kMapFileAlignment - 1) / kMapFileAlignment * kMapFileAlignment; }
+
+} // namespace detail
+
+/** Writes `grid` and whatever precomputed data is given; returns false on I/O errors.
+ *
+ * `clearance` and `landmarks` are skipped if null. Both must have been
+ * computed for this grid.
+ */
+inline bool saveMapFile(const std::string &path, const OccupancyGrid &grid, const MapInfo &info,
+                        const Costmap *clearance = nullptr, const astar::LandmarkTable *landmarks = nullptr) {
+  struct Payload {
+    detail::MapSection type;
+    float param;
+    const void *data;
+    size_t size;
+  };
+  std::vector<Payload> payloads;
+  payloads.push_back({detail::MapSection::kCells, 0.0f, grid.data(), grid.cellCount()});
+  payloads.push_back({detail::MapSection::kPassable, 0.0f, grid.passableData(), grid.passableWords() * sizeof(uint64_t)});
+  if (clearance != nullptr) {
+    payloads.push_back({detail::MapSection::kClearance, clearance->clearanceCap(), clearance->clearances(),
+                        grid.cellCount() * sizeof(float)});
+  }
+  std::vector<int32_t> points;
+  if (landmarks != nullptr && !landmarks->landmarks.empty()) {
+    for (const astar::Point &p : landmarks->landmarks) {
+      points.push_back(p.x);
+      points.push_back(p.y);
+    }
+    payloads.push_back({detail::MapSection::kLandmarks, 0.0f, points.data(), points.size() * sizeof(int32_t)});
+    payloads.push_back({detail::MapSection::kLandmarkDistances, 0.0f, landmarks->distanceData(),
+                        landmarks->landmarks.size() * landmarks->cellCount() * sizeof(float)});
+  }
+
+  detail::MapFileHeader header{};
+  header.magic = detail::kMapFileMagic;
+  header.format = detail::kMapFileFormat;
+  header.width = grid.width();
+  header.height = grid.height();
+  header.resolution = info.resolution;
+  header.originX = info.originX;
+  header.originY = info.originY;
+  header.originYaw = info.originYaw;
+  header.occupiedThresh = info.occupiedThresh;
+  header.freeThresh = info.freeThresh;
+  header.negate = info.negate ? 1u : 0u;
+  header.mode = static_cast<uint32_t>(info.mode);
+  header.mapHash = passabilityHash(grid);
+  header.sectionCount = static_cast<uint32_t>(payloads.size());
+
+  std::vector<detail::MapSectionEntry> entries;
+  size_t offset = detail::alignedSize(sizeof(header) + payloads.size() * sizeof(detail::MapSectionEntry));
+  for (const Payload &payload : payloads) {
+    entries.push_back({static_cast<uint32_t>(payload.type), payload.param, offset, payload.size});
+    offset += detail::alignedSize(payload.size);
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) return false;
+  const char padding[detail::kMapFileAlignment] = {};
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(entries.data()),
+             static_cast<std::streamsize>(entries.size() * sizeof(detail::MapSectionEntry)));
+  size_t written = sizeof(header) + entries.size() * sizeof(detail::MapSectionEntry);
+  for (size_t i = 0; i < payloads.size(); ++i) {
+    file.write(padding, static_cast<std::streamsize>(entries[i].offset - written));
+    file.write(static_cast<const char *>(payloads[i].data), static_cast<std::streamsize>(payloads[i].size));
+    written = entries[i].offset + payloads[i].size;
+  }
+  file.write(padding, static_cast<std::streamsize>(offset - written));
+  return static_cast<bool>(file);
+}
+
+/** Maps a file written by saveMapFile() and wraps it in `grid`, without copying.
+ *
+ * Returns false if the file is missing, truncated, of another format or
+ * inconsistent; `grid` and `contents` are left alone then.
+ */
+inline bool openMapFile(const std::string &path, OccupancyGrid &grid, MapFile &contents) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat status{};
+  if (::fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(detail::MapFileHeader)) {
+    ::close(fd);
+    return false;
+  }
+  const size_t size = static_cast<size_t>(status.st_size);
+  void *address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd); // The mapping stays valid
+  if (address == MAP_FAILED) return false;
+  std::shared_ptr<void> mapping(address, [size](void *p) { ::munmap(p, size); });
+
+  char *base = static_cast<char *>(address);
+  detail::MapFileHeader header;
+  std::memcpy(&header, base, sizeof(header));
+  if (header.magic != detail::kMapFileMagic || header.format != detail::kMapFileFormat || header.width <= 0 ||
+      header.height <= 0 || header.sectionCount > (size - sizeof(header)) / sizeof(detail::MapSectionEntry)) {
+    return false;
+  }
+
+  const size_t cells = static_cast<size_t>(header.width) * static_cast<size_t>(header.height);
+  char *cellData = nullptr;
+  char *passableData = nullptr;
+  const char *points = nullptr;
+  size_t pointBytes = 0;
+  const char *landmarkDistances = nullptr;
+  size_t landmarkBytes = 0;
+  MapFile loaded;
+  for (uint32_t i = 0; i < header.sectionCount; ++i) {
+    detail::MapSectionEntry entry;
+    std::memcpy(&entry, base + sizeof(header) + i * sizeof(entry), sizeof(entry));
+    if (entry.offset % detail::kMapFileAlignment != 0 || entry.offset > size || entry.size > size - entry.offset) {
+      return false;
+    }
+    char *data = base + entry.offset;
+    switch (static_cast<detail::MapSection>(entry.type)) {
+      case detail::MapSection::kCells:
+        if (entry.size != cells) return false;
+        cellData = data;
+        break;
+      case detail::MapSection::kPassable:
+        if (entry.size != OccupancyGrid::passableWordCount(header.width, header.height) * sizeof(uint64_t)) {
+          return false;
+        }
+        passableData = data;
+        break;
+      case detail::MapSection::kClearance:
+        if (entry.size != cells * sizeof(float)) return false;
+        loaded.clearance.distances = reinterpret_cast<const float *>(data);
+        loaded.clearance.cap = entry.param;
+        break;
+      case detail::MapSection::kLandmarks:
+        points = data;
+        pointBytes = static_cast<size_t>(entry.size);
+        break;
+      case detail::MapSection::kLandmarkDistances:
+        landmarkDistances = data;
+        landmarkBytes = static_cast<size_t>(entry.size);
+        break;
+      default:
+        break; // Sections from newer writers are skipped
+    }
+  }
+  if (cellData == nullptr || passableData == nullptr) return false;
+
+  if (points != nullptr && landmarkDistances != nullptr && pointBytes % (2 * sizeof(int32_t)) == 0 &&
+      landmarkBytes == pointBytes / (2 * sizeof(int32_t)) * cells * sizeof(float)) {
+    auto table = std::make_shared<astar::LandmarkTable>();
+    table->width = header.width;
+    table->height = header.height;
+    table->mapHash = header.mapHash;
+    for (size_t i = 0; i < pointBytes / sizeof(int32_t); i += 2) {
+      int32_t xy[2];
+      std::memcpy(xy, points + i * sizeof(int32_t), sizeof(xy));
+      table->landmarks.emplace_back(xy[0], xy[1]);
+    }
+    table->externalDistances = reinterpret_cast<const float *>(landmarkDistances);
+    table->storage = mapping;
+    loaded.landmarks = std::move(table);
+  }
+  if (loaded.clearance.distances != nullptr) {
+    loaded.clearance.width = header.width;
+    loaded.clearance.height = header.height;
+    loaded.clearance.mapHash = header.mapHash;
+    loaded.clearance.storage = mapping;
+  }
+
+  loaded.info.image = path;
+  loaded.info.resolution = header.resolution;
+  loaded.info.originX = header.originX;
+  loaded.info.originY = header.originY;
+  loaded.info.originYaw = header.originYaw;
+  loaded.info.occupiedThresh = header.occupiedThresh;
+  loaded.info.freeThresh = header.freeThresh;
+  loaded.info.negate = header.negate != 0;
+  loaded.info.mode = static_cast<MapMode>(header.mode);
+  loaded.metaData = loaded.info.metaData(header.width, header.height);
+
+  grid = OccupancyGrid(header.width, header.height, reinterpret_cast<int8_t *>(cellData),
+                       reinterpret_cast<uint64_t *>(passableData), std::move(mapping));
+  contents = std::move(loaded);
+  return true;
+}
+
+} // namespace gridmap
+
+#endif // MAP_FILE_HPP_
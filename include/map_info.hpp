@@ -0,0 +1,141 @@
+#ifndef MAP_INFO_HPP_
+#define MAP_INFO_HPP_
+
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "occupancy_grid.hpp"
+
+namespace gridmap {
+
+/// How pixel values map to occupancy, as in map_server.
+enum class MapMode {
+  kTrinary,
+  kScale,
+  kRaw,
+};
+
+/** Map description as written by map_server (the YAML next to the image).
+ *
+ * Thresholds are occupancy probabilities; with `negate` unset a black pixel
+ * is probability 1.
+ */
+struct MapInfo {
+  std::string image;      // Resolved against the directory of the YAML file
+  float resolution = 1.0f; // Meters per cell
+  float originX = 0.0f;   // Pose of the bottom-left cell, meters and radians
+  float originY = 0.0f;
+  float originYaw = 0.0f;
+  bool negate = false;
+  float occupiedThresh = 0.65f;
+  float freeThresh = 0.196f;
+  MapMode mode = MapMode::kTrinary;
+
+  MapMetaData metaData(int width, int height) const {
+    return {width, height, resolution, originX, originY};
+  }
+};
+
+namespace detail {
+
+inline std::string trimmed(const std::string &s) {
+  const size_t begin = s.find_first_not_of(" \t\r");
+  if (begin == std::string::npos) return std::string();
+  const size_t end = s.find_last_not_of(" \t\r");
+  std::string out = s.substr(begin, end - begin + 1);
+  if (out.size() >= 2 && (out.front() == '"' || out.front() == '\'') && out.back() == out.front()) {
+    out = out.substr(1, out.size() - 2);
+  }
+  return out;
+}
+
+inline bool parseFloat(const std::string &s, float &out) {
+  const std::string t = trimmed(s);
+  char *end = nullptr;
+  const float value = std::strtof(t.c_str(), &end);
+  if (t.empty() || end != t.c_str() + t.size()) return false;
+  out = value;
+  return true;
+}
+
+} // namespace detail
+
+/** Reads a map_server map YAML.
+ *
+ * Only the flat keys map_server uses are understood; `origin` may be a flow
+ * list ([x, y, yaw]) or a block list. A relative `image` is resolved against
+ * the YAML's directory. Returns false if the file cannot be read or lacks
+ * `image` or `resolution`.
+ */
+inline bool loadMapYaml(const std::string &path, MapInfo &info) {
+  std::ifstream file(path);
+  if (!file) return false;
+
+  MapInfo loaded;
+  bool hasImage = false;
+  bool hasResolution = false;
+  float origin[3] = {0.0f, 0.0f, 0.0f};
+  int originItems = -1; // >= 0 while reading a block list under `origin:`
+  std::string line;
+  while (std::getline(file, line)) {
+    const size_t comment = line.find('#');
+    if (comment != std::string::npos) line.erase(comment);
+    const std::string content = detail::trimmed(line);
+    if (content.empty()) continue;
+
+    if (content[0] == '-') {
+      if (originItems >= 0 && originItems < 3 && detail::parseFloat(content.substr(1), origin[originItems])) {
+        ++originItems;
+      }
+      continue;
+    }
+    originItems = -1;
+
+    const size_t colon = content.find(':');
+    if (colon == std::string::npos) continue;
+    const std::string key = detail::trimmed(content.substr(0, colon));
+    const std::string value = detail::trimmed(content.substr(colon + 1));
+
+    if (key == "image") {
+      loaded.image = value;
+      hasImage = !value.empty();
+    } else if (key == "resolution") {
+      hasResolution = detail::parseFloat(value, loaded.resolution);
+    } else if (key == "negate") {
+      loaded.negate = value == "1" || value == "true";
+    } else if (key == "occupied_thresh") {
+      detail::parseFloat(value, loaded.occupiedThresh);
+    } else if (key == "free_thresh") {
+      detail::parseFloat(value, loaded.freeThresh);
+    } else if (key == "mode") {
+      loaded.mode = value == "scale" ? MapMode::kScale : value == "raw" ? MapMode::kRaw : MapMode::kTrinary;
+    } else if (key == "origin") {
+      if (value.empty()) {
+        originItems = 0;
+      } else if (value.front() == '[' && value.back() == ']') {
+        std::string items = value.substr(1, value.size() - 2);
+        for (int i = 0; i < 3 && !items.empty(); ++i) {
+          const size_t comma = items.find(',');
+          detail::parseFloat(items.substr(0, comma), origin[i]);
+          items = comma == std::string::npos ? std::string() : items.substr(comma + 1);
+        }
+      }
+    }
+  }
+  if (!hasImage || !hasResolution) return false;
+
+  loaded.originX = origin[0];
+  loaded.originY = origin[1];
+  loaded.originYaw = origin[2];
+  if (loaded.image.front() != '/') {
+    const size_t slash = path.find_last_of('/');
+    if (slash != std::string::npos) loaded.image = path.substr(0, slash + 1) + loaded.image;
+  }
+  info = loaded;
+  return true;
+}
+
+} // namespace gridmap
+
+#endif // MAP_INFO_HPP_
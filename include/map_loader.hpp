@@ -0,0 +1,50 @@
+#ifndef MAP_LOADER_HPP_
+#define MAP_LOADER_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "stb_image.h"
+#include "map_info.hpp"
+#include "occupancy_grid.hpp"
+#include "pixel_classifier.hpp"
+
+namespace gridmap {
+
+/** Loads a grayscale map image into an occupancy grid.
+ *
+ * Pixels are classified by the thresholds, `negate` and mode in `info`, as
+ * map_server does; the defaults match data/map.yaml. Image rows run top to
+ * bottom while map rows run bottom to top, so the image is flipped. Each
+ * row is converted by a SIMD kernel that writes the occupancy values and
+ * the packed passability bits in the same pass. The including program must
+ * define STB_IMAGE_IMPLEMENTATION once. Returns false if the image cannot
+ * be read; stbi_failure_reason() tells why.
+ */
+inline bool loadImageMap(const std::string &path, OccupancyGrid &grid, const MapInfo &info = MapInfo(),
+                         PixelKernel kernel = bestPixelKernel()) {
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  auto stbiDeleter = [](unsigned char *p) { stbi_image_free(p); };
+  std::unique_ptr<unsigned char, decltype(stbiDeleter)>
+    data(stbi_load(path.c_str(), &width, &height, &channels, 1), stbiDeleter);
+  if (!data) return false;
+
+  // Both layers are overwritten row by row, so skip the free fill
+  grid = OccupancyGrid(width, height, OccupancyGrid::kUnknown);
+  const PixelClassifier classifier(info);
+  std::vector<uint64_t> masks((static_cast<size_t>(width) + 63) / 64);
+  for (int row = 0; row < height; ++row) {
+    const unsigned char *pixels = data.get() + static_cast<size_t>(row) * width;
+    classifier.convertRow(pixels, height - 1 - row, grid, masks.data(), kernel);
+  }
+  grid.finishBulkWrite();
+  return true;
+}
+
+} // namespace gridmap
+
+#endif // MAP_LOADER_HPP_
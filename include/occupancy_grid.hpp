@@ -0,0 +1,325 @@
+#ifndef OCCUPANCY_GRID_HPP_
+#define OCCUPANCY_GRID_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace gridmap {
+
+/** Create ROS-style Occupancy Grid Map metadata (nav_msgs/MapMetaData) */
+struct MapMetaData {
+  int width;
+  int height;
+  float resolution; // meters per pixel
+  float origin_x;   // origin in meters
+  float origin_y;   // origin in meters
+};
+
+/// Half-open rectangle of cells, [x0, x1) x [y0, y1).
+struct CellRect {
+  int x0 = 0;
+  int y0 = 0;
+  int x1 = 0;
+  int y1 = 0;
+
+  bool empty() const { return x1 <= x0 || y1 <= y0; }
+  int width() const { return x1 - x0; }
+  int height() const { return y1 - y0; }
+
+  bool contains(int x, int y) const {
+    return x >= x0 && x < x1 && y >= y0 && y < y1;
+  }
+
+  bool intersects(const CellRect &o) const {
+    return x0 < o.x1 && o.x0 < x1 && y0 < o.y1 && o.y0 < y1;
+  }
+
+  /// Smallest rectangle covering both; an empty rectangle acts as identity.
+  CellRect united(const CellRect &o) const {
+    if (empty()) return o;
+    if (o.empty()) return *this;
+    return {std::min(x0, o.x0), std::min(y0, o.y0), std::max(x1, o.x1), std::max(y1, o.y1)};
+  }
+
+  CellRect intersected(const CellRect &o) const {
+    return {std::max(x0, o.x0), std::max(y0, o.y0), std::min(x1, o.x1), std::min(y1, o.y1)};
+  }
+
+  CellRect expanded(int margin) const {
+    return {x0 - margin, y0 - margin, x1 + margin, y1 + margin};
+  }
+};
+
+/** Row-major occupancy grid shared by the renderer and the planners.
+ *
+ * Cells are addressed in the map frame: (0, 0) is the bottom-left cell and
+ * rows are stored bottom to top, as in nav_msgs/OccupancyGrid.
+ *
+ * Two layers are kept in sync:
+ * - an int8 probability layer, [0,100] with unknown = -1
+ * - a bit-packed passability layer, one bit per cell, 64 cells per word
+ *
+ * The passability rows are padded with one guard column on each side and a
+ * guard row above and below, all marked blocked. That lets neighbor queries
+ * read a 3-cell window with one unaligned word read and no bounds checks.
+ *
+ * Both layers normally live in vectors owned by the grid. A grid can also
+ * wrap memory it does not own, such as a mapped map file; copies of such a
+ * grid own their layers again.
+ */
+class OccupancyGrid {
+public:
+  static constexpr int8_t kFree = 0;
+  static constexpr int8_t kOccupied = 100;
+  static constexpr int8_t kUnknown = -1;
+
+  OccupancyGrid() = default;
+
+  OccupancyGrid(int width_, int height_, int8_t fill = kFree) :
+    gridWidth(width_), gridHeight(height_), rowWords(rowWordCount(width_)),
+    ownedCells(static_cast<size_t>(width_) * static_cast<size_t>(height_), fill),
+    ownedPassable(passableWordCount(width_, height_), 0),
+    cells(ownedCells.data()), passable(ownedPassable.data()) {
+    // Uniform fill: whole rows of bits instead of a per-cell rebuild
+    if (isFreeValue(fill)) {
+      for (int y = 0; y < gridHeight; ++y) {
+        uint64_t *bits = mutablePassableRow(y);
+        for (size_t bit = 1; bit <= static_cast<size_t>(gridWidth);) {
+          const size_t count = std::min<size_t>(64 - (bit & 63), static_cast<size_t>(gridWidth) + 1 - bit);
+          bits[bit >> 6] |= (count == 64 ? ~uint64_t{0} : ((uint64_t{1} << count) - 1)) << (bit & 63);
+          bit += count;
+        }
+      }
+    }
+    finishBulkWrite();
+  }
+
+  /** Wraps both layers in place, without copying or validating them.
+   *
+   * `cells_` holds width * height values and `passable_` the
+   * passableWordCount() words of a matching passability layer, guard bits
+   * included. `storage` keeps that memory alive for as long as the grid
+   * uses it. Edits write to that memory.
+   */
+  OccupancyGrid(int width_, int height_, int8_t *cells_, uint64_t *passable_, std::shared_ptr<void> storage_) :
+    gridWidth(width_), gridHeight(height_), rowWords(rowWordCount(width_)),
+    cells(cells_), passable(passable_), storage(std::move(storage_)), mapVersion(1), journalBase(1) {}
+
+  OccupancyGrid(const OccupancyGrid &o) :
+    gridWidth(o.gridWidth), gridHeight(o.gridHeight), rowWords(o.rowWords),
+    ownedCells(o.cells, o.cells + o.cellCount()),
+    ownedPassable(o.passable, o.passable + o.passableWords()),
+    cells(ownedCells.data()), passable(ownedPassable.data()),
+    mapVersion(o.mapVersion), journal(o.journal), journalBase(o.journalBase) {}
+
+  // Moving a vector keeps its buffer, so the layer pointers stay valid
+  OccupancyGrid(OccupancyGrid &&o) noexcept { swap(o); }
+
+  OccupancyGrid &operator=(OccupancyGrid o) noexcept {
+    swap(o);
+    return *this;
+  }
+
+  void swap(OccupancyGrid &o) noexcept {
+    std::swap(gridWidth, o.gridWidth);
+    std::swap(gridHeight, o.gridHeight);
+    std::swap(rowWords, o.rowWords);
+    ownedCells.swap(o.ownedCells);
+    ownedPassable.swap(o.ownedPassable);
+    std::swap(cells, o.cells);
+    std::swap(passable, o.passable);
+    storage.swap(o.storage);
+    std::swap(mapVersion, o.mapVersion);
+    journal.swap(o.journal);
+    std::swap(journalBase, o.journalBase);
+  }
+
+  /// Words per passability row: the cells plus a guard column on each side, and one spare word.
+  static size_t rowWordCount(int width) { return static_cast<size_t>((width + 2 + 63) / 64 + 1); }
+
+  /// Words in the passability layer: the rows plus a guard row above and below.
+  static size_t passableWordCount(int width, int height) {
+    return rowWordCount(width) * static_cast<size_t>(height + 2) + 1; // +1: slack for window reads
+  }
+
+  int width() const { return gridWidth; }
+  int height() const { return gridHeight; }
+  size_t cellCount() const { return static_cast<size_t>(gridWidth) * static_cast<size_t>(gridHeight); }
+  CellRect bounds() const { return {0, 0, gridWidth, gridHeight}; }
+
+  bool inBounds(int x, int y) const {
+    return x >= 0 && x < gridWidth && y >= 0 && y < gridHeight;
+  }
+
+  size_t index(int x, int y) const {
+    return static_cast<size_t>(y) * static_cast<size_t>(gridWidth) + static_cast<size_t>(x);
+  }
+
+  static bool isFreeValue(int8_t value) { return value == kFree; }
+
+  int8_t value(int x, int y) const { return cells[index(x, y)]; }
+
+  void setValue(int x, int y, int8_t value) {
+    if (!inBounds(x, y)) return;
+    cells[index(x, y)] = value;
+    setPassableBit(x, y, isFreeValue(value));
+    ++mapVersion;
+    record(static_cast<int32_t>(index(x, y)));
+  }
+
+  const int8_t *data() const { return cells; }
+
+  /// Raw access to the probability layer. Call rebuildPassability() after bulk writes.
+  int8_t *mutableData() { return cells; }
+
+  void rebuildPassability() {
+    std::fill(passable, passable + passableWords(), 0);
+    for (int y = 0; y < gridHeight; ++y) {
+      const int8_t *row = cells + index(0, y);
+      uint64_t *bits = mutablePassableRow(y);
+      for (int x = 0; x < gridWidth; ++x) {
+        const size_t bit = static_cast<size_t>(x) + 1;
+        bits[bit >> 6] |= static_cast<uint64_t>(isFreeValue(row[x])) << (bit & 63);
+      }
+    }
+    finishBulkWrite();
+  }
+
+  /** Raw access to packed passability row y (0 <= y < height), for loaders that fill both layers at once.
+   *
+   * The guard bits (bit 0 and everything past bit width) must stay clear.
+   * Call finishBulkWrite() when done.
+   */
+  uint64_t *mutablePassableRow(int y) { return passable + static_cast<size_t>(y + 1) * rowWords; }
+
+  /// Marks the end of raw writes through mutableData() and mutablePassableRow() that kept both layers in sync.
+  void finishBulkWrite() {
+    ++mapVersion;
+    // Bulk rewrites are not journaled; incremental consumers have to start over
+    journal.clear();
+    journalBase = mapVersion;
+  }
+
+  bool isPassable(int x, int y) const {
+    if (!inBounds(x, y)) return false;
+    const size_t bit = static_cast<size_t>(x) + 1;
+    return (passableRow(y)[bit >> 6] >> (bit & 63)) & 1u;
+  }
+
+  /// Passability of cells x-1, x, x+1 in row y as bits 0..2; outside the map reads as blocked.
+  /// Valid for -1 <= y <= height and 0 <= x < width.
+  unsigned passableTriple(int x, int y) const {
+    const uint64_t *row = passableRow(y);
+    const size_t bit = static_cast<size_t>(x); // bit of cell x-1
+    const size_t word = bit >> 6;
+    const unsigned shift = static_cast<unsigned>(bit & 63);
+    // Second word contributes its low bits when the window straddles a word boundary.
+    const uint64_t window = (row[word] >> shift) | ((row[word + 1] << 1) << (63 - shift));
+    return static_cast<unsigned>(window & 7u);
+  }
+
+  /// 3x3 neighborhood of (x, y); bit (dy+1)*3 + (dx+1) is set if that cell is passable.
+  unsigned passableNeighborhood(int x, int y) const {
+    return passableTriple(x, y - 1) | (passableTriple(x, y) << 3) | (passableTriple(x, y + 1) << 6);
+  }
+
+  /// Packed passability row y (-1 <= y <= height); cell x lives at bit x+1.
+  const uint64_t *passableRow(int y) const {
+    return passable + static_cast<size_t>(y + 1) * rowWords;
+  }
+
+  /// Passability of the 64 cells first..first+63 in row y, bit i for cell first+i.
+  /// Cells outside the map read as blocked. Valid for first <= width + 1.
+  uint64_t passableWindow(int first, int y) const {
+    const uint64_t *row = passableRow(y);
+    if (first < -1) {
+      const int missing = -1 - first;
+      return missing >= 64 ? 0 : passableWindow(-1, y) << missing;
+    }
+    const size_t bit = static_cast<size_t>(first + 1);
+    const size_t word = bit >> 6;
+    const unsigned shift = static_cast<unsigned>(bit & 63);
+    return (row[word] >> shift) | ((row[word + 1] << 1) << (63 - shift));
+  }
+
+  size_t wordsPerRow() const { return rowWords; }
+  size_t passableWords() const { return gridWidth > 0 ? passableWordCount(gridWidth, gridHeight) : 0; }
+
+  /// The whole passability layer, guard rows included, passableWords() long.
+  const uint64_t *passableData() const { return passable; }
+
+  /// Incremented on every modification; consumers use it to detect stale caches.
+  uint64_t version() const { return mapVersion; }
+
+  /** Appends the cells changed after version `since` to `changed`, oldest first.
+   *
+   * Returns false if the journal does not reach back that far, either because
+   * of a bulk rewrite or because older entries were dropped; the caller then
+   * has to treat the whole grid as changed. A cell may appear more than once.
+   */
+  bool changesSince(uint64_t since, std::vector<int32_t> &changed) const {
+    if (since < journalBase) return false;
+    auto first = std::upper_bound(journal.begin(), journal.end(), since,
+                                  [](uint64_t v, const JournalEntry &e) { return v < e.version; });
+    for (; first != journal.end(); ++first) changed.push_back(first->cell);
+    return true;
+  }
+
+private:
+  int gridWidth = 0;
+  int gridHeight = 0;
+  size_t rowWords = 0;
+  std::vector<int8_t> ownedCells;
+  std::vector<uint64_t> ownedPassable;
+  int8_t *cells = nullptr;       // ownedCells or external memory
+  uint64_t *passable = nullptr;  // ownedPassable or external memory
+  std::shared_ptr<void> storage; // Keeps external memory alive
+  uint64_t mapVersion = 0;
+
+  struct JournalEntry {
+    uint64_t version;
+    int32_t cell;
+  };
+  static constexpr size_t kJournalCapacity = 1 << 16;
+  std::vector<JournalEntry> journal;
+  uint64_t journalBase = 0; // The journal holds every change with a version above this
+
+  void record(int32_t cell) {
+    if (journal.size() == kJournalCapacity) {
+      const size_t dropped = kJournalCapacity / 2;
+      journalBase = journal[dropped - 1].version;
+      journal.erase(journal.begin(), journal.begin() + static_cast<std::ptrdiff_t>(dropped));
+    }
+    journal.push_back({mapVersion, cell});
+  }
+
+  void setPassableBit(int x, int y, bool isFree) {
+    const size_t bit = static_cast<size_t>(x) + 1;
+    uint64_t &word = passable[static_cast<size_t>(y + 1) * rowWords + (bit >> 6)];
+    const uint64_t mask = uint64_t{1} << (bit & 63);
+    word = isFree ? (word | mask) : (word & ~mask);
+  }
+};
+
+/// FNV-1a over the passability of every cell; data precomputed for one map is only reused for the same map.
+inline uint64_t passabilityHash(const OccupancyGrid &grid) {
+  uint64_t hash = 1469598103934665603ull;
+  auto mix = [&hash](uint64_t v) {
+    hash ^= v;
+    hash *= 1099511628211ull;
+  };
+  mix(static_cast<uint64_t>(grid.width()));
+  mix(static_cast<uint64_t>(grid.height()));
+  for (int y = 0; y < grid.height(); ++y) {
+    const uint64_t *row = grid.passableRow(y);
+    for (size_t w = 0; w < grid.wordsPerRow(); ++w) mix(row[w]);
+  }
+  return hash;
+}
+
+} // namespace gridmap
+
+#endif // OCCUPANCY_GRID_HPP_
@@ -0,0 +1,193 @@
+#ifndef OPEN_LIST_HPP_
+#define OPEN_LIST_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "search_workspace.hpp"
+
+namespace astar {
+
+/** Open lists for BasicAStar, selected by its `OpenList` template parameter.
+ *
+ * Each is a thin view over storage owned by the SearchWorkspace, constructed
+ * at the start of a query, with the same interface:
+ *
+ *   push(fCost, hCost, index)  queue a node opened in the workspace, or
+ *                              re-queue it at a lower cost
+ *   pop()                      remove the entry with the lowest f cost
+ *   empty(), size()
+ *
+ * `kDecreaseKey` tells whether push() updates a queued node in place. Lists
+ * without it leave the old entry behind, and the search skips it once the
+ * node is closed; every node is expanded at most once either way.
+ */
+
+/// The workspace's binary heap with lazy deletion; cheap pushes, but the heap grows by one entry per improvement.
+class LazyHeapOpenList {
+public:
+  static constexpr bool kDecreaseKey = false;
+
+  explicit LazyHeapOpenList(SearchWorkspace &workspace_) : workspace(workspace_) {}
+
+  void push(float fCost, float hCost, int32_t index) { workspace.pushOpen(fCost, hCost, index); }
+  SearchWorkspace::OpenEntry pop() { return workspace.popOpen(); }
+  bool empty() const { return workspace.openEmpty(); }
+  size_t size() const { return workspace.openSize(); }
+
+private:
+  SearchWorkspace &workspace;
+};
+
+/** Indexed d-ary min-heap with decrease-key.
+ *
+ * Every queued node stores its heap position in NodeRecord::heapIndex, so
+ * an improved node is sifted up from where it is instead of being pushed
+ * again; the heap never holds more entries than the frontier. A 4-ary heap
+ * is half as deep as a binary one and its children share a cache line,
+ * which pays for the extra comparisons on the way down.
+ */
+template <int Arity = 4>
+class IndexedHeapOpenList {
+  static_assert(Arity >= 2, "a heap needs at least two children per node");
+
+public:
+  static constexpr bool kDecreaseKey = true;
+
+  explicit IndexedHeapOpenList(SearchWorkspace &workspace_) :
+    workspace(workspace_), heap(workspace_.openEntries()) {}
+
+  void push(float fCost, float hCost, int32_t index) {
+    const int32_t position = workspace.node(index).heapIndex;
+    if (position < 0) {
+      heap.push_back({fCost, hCost, index});
+      siftUp(heap.size() - 1);
+    } else {
+      heap[static_cast<size_t>(position)] = {fCost, hCost, index};
+      siftUp(static_cast<size_t>(position));
+    }
+  }
+
+  SearchWorkspace::OpenEntry pop() {
+    const SearchWorkspace::OpenEntry top = heap.front();
+    workspace.node(top.index).heapIndex = -1;
+    const SearchWorkspace::OpenEntry last = heap.back();
+    heap.pop_back();
+    if (!heap.empty()) {
+      heap.front() = last;
+      siftDown(0);
+    }
+    return top;
+  }
+
+  bool empty() const { return heap.empty(); }
+  size_t size() const { return heap.size(); }
+
+private:
+  SearchWorkspace &workspace;
+  std::vector<SearchWorkspace::OpenEntry> &heap;
+
+  /// Lower f first; among f costs equal up to rounding, the entry closer to the goal.
+  static bool before(const SearchWorkspace::OpenEntry &lhs, const SearchWorkspace::OpenEntry &rhs) {
+    return lhs.before(rhs);
+  }
+
+  void place(size_t position, const SearchWorkspace::OpenEntry &entry) {
+    heap[position] = entry;
+    workspace.node(entry.index).heapIndex = static_cast<int32_t>(position);
+  }
+
+  void siftUp(size_t position) {
+    const SearchWorkspace::OpenEntry entry = heap[position];
+    while (position > 0) {
+      const size_t parent = (position - 1) / Arity;
+      if (!before(entry, heap[parent])) break;
+      place(position, heap[parent]);
+      position = parent;
+    }
+    place(position, entry);
+  }
+
+  void siftDown(size_t position) {
+    const SearchWorkspace::OpenEntry entry = heap[position];
+    const size_t count = heap.size();
+    for (;;) {
+      const size_t first = position * Arity + 1;
+      if (first >= count) break;
+      const size_t last = std::min(first + Arity, count);
+      size_t best = first;
+      for (size_t child = first + 1; child < last; ++child) {
+        if (before(heap[child], heap[best])) best = child;
+      }
+      if (!before(heap[best], entry)) break;
+      place(position, heap[best]);
+      position = best;
+    }
+    place(position, entry);
+  }
+};
+
+/** Bucket queue over f costs quantized to 1 / `Resolution`.
+ *
+ * Pushes and pops are O(1): with a consistent heuristic f never decreases
+ * along the search, so pop() only ever moves a cursor forward over the
+ * buckets. Entries in one bucket come out last in, first out, which
+ * favours the nodes pushed most recently, usually the ones closest to the
+ * goal. Because ties within a bucket are broken arbitrarily, a path may
+ * cost slightly more than the optimum, by less than a bucket width for
+ * each suboptimally closed node on it. Improvements push a second entry as
+ * in LazyHeapOpenList.
+ */
+template <int Resolution = 16>
+class BucketOpenList {
+  static_assert(Resolution > 0, "buckets need a positive resolution");
+
+public:
+  static constexpr bool kDecreaseKey = false;
+
+  explicit BucketOpenList(SearchWorkspace &workspace_) : buckets(workspace_.openBuckets()) {}
+
+  ~BucketOpenList() {
+    // An early exit leaves entries behind; the next query expects empty buckets
+    for (size_t b = cursor; b < end; ++b) buckets[b].clear();
+  }
+
+  BucketOpenList(const BucketOpenList &) = delete;
+  BucketOpenList &operator=(const BucketOpenList &) = delete;
+
+  void push(float fCost, float hCost, int32_t index) {
+    const int64_t key = static_cast<int64_t>(std::floor(fCost * static_cast<float>(Resolution)));
+    if (count == 0 && end == 0) baseKey = key;
+    // An inconsistent heuristic could go below the cursor; such entries are taken next
+    const size_t bucket = std::max(static_cast<size_t>(std::max<int64_t>(key - baseKey, 0)), cursor);
+    if (bucket >= buckets.size()) buckets.resize(std::max(bucket + 1, buckets.size() * 2));
+    buckets[bucket].push_back({fCost, hCost, index});
+    end = std::max(end, bucket + 1);
+    ++count;
+  }
+
+  SearchWorkspace::OpenEntry pop() {
+    while (buckets[cursor].empty()) ++cursor;
+    const SearchWorkspace::OpenEntry entry = buckets[cursor].back();
+    buckets[cursor].pop_back();
+    --count;
+    return entry;
+  }
+
+  bool empty() const { return count == 0; }
+  size_t size() const { return count; }
+
+private:
+  std::vector<std::vector<SearchWorkspace::OpenEntry>> &buckets;
+  int64_t baseKey = 0;
+  size_t cursor = 0; // Every bucket below is empty
+  size_t end = 0;    // Every bucket from here on is empty
+  size_t count = 0;
+};
+
+} // namespace astar
+
+#endif // OPEN_LIST_HPP_
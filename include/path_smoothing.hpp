@@ -0,0 +1,267 @@
+#ifndef PATH_SMOOTHING_HPP_
+#define PATH_SMOOTHING_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "occupancy_grid.hpp"
+#include "point.hpp"
+
+namespace astar {
+
+/** Whether the segment between two points crosses only passable cells.
+ *
+ * Coordinates are in cells, continuous: cell (x, y) spans [x, x+1) x [y, y+1)
+ * and its center is (x + 0.5, y + 0.5). Every cell the segment passes
+ * through counts; cells it only touches at a corner do not, which matches
+ * the planners' diagonal moves. The cells crossed in one row form a
+ * contiguous span, which is tested 64 cells at a time against the packed
+ * passability rows, so the cost grows with the number of rows spanned.
+ */
+inline bool lineOfSight(const gridmap::OccupancyGrid &grid, double ax, double ay, double bx, double by) {
+  constexpr double kEpsilon = 1e-9;
+  if (ay > by) {
+    std::swap(ax, bx);
+    std::swap(ay, by);
+  }
+  const int firstRow = static_cast<int>(std::floor(ay));
+  const int lastRow = by > ay ? static_cast<int>(std::ceil(by - kEpsilon)) - 1 : firstRow;
+  if (firstRow < 0 || lastRow >= grid.height()) return false;
+  const double slope = by > ay ? (bx - ax) / (by - ay) : 0.0;
+
+  for (int y = firstRow; y <= std::max(firstRow, lastRow); ++y) {
+    double xa = ax;
+    double xb = bx;
+    if (by > ay) {
+      xa = ax + (std::max(ay, static_cast<double>(y)) - ay) * slope;
+      xb = ax + (std::min(by, static_cast<double>(y + 1)) - ay) * slope;
+    }
+    const double lo = std::min(xa, xb);
+    const double hi = std::max(xa, xb);
+    const int first = static_cast<int>(std::floor(lo + kEpsilon));
+    const int last = std::max(first, static_cast<int>(std::ceil(hi - kEpsilon)) - 1);
+    if (first < 0 || last >= grid.width()) return false;
+
+    for (int x = first; x <= last; x += 64) {
+      const int count = std::min(64, last - x + 1);
+      const uint64_t wanted = count == 64 ? ~uint64_t{0} : (uint64_t{1} << count) - 1;
+      if ((grid.passableWindow(x, y) & wanted) != wanted) return false;
+    }
+  }
+  return true;
+}
+
+/// Line of sight between the centers of two cells.
+inline bool lineOfSight(const gridmap::OccupancyGrid &grid, const Point &a, const Point &b) {
+  return lineOfSight(grid, a.x + 0.5, a.y + 0.5, b.x + 0.5, b.y + 0.5);
+}
+
+/** Shortens a cell path by string pulling.
+ *
+ * Keeps a cell only where the path can no longer be seen from the last kept
+ * one. Only the cells where the path changes direction are candidates, so a
+ * long straight run costs one visibility check. The result starts and ends
+ * with the ends of `path`, and every consecutive pair has line of sight.
+ */
+inline void shortcutPath(const gridmap::OccupancyGrid &grid, const std::vector<Point> &path, std::vector<Point> &out) {
+  out.clear();
+  if (path.size() < 3) {
+    out = path;
+    return;
+  }
+  out.push_back(path.front());
+  Point previous = path.front(); // Last turning point that was visible from the anchor
+  for (size_t i = 1; i + 1 < path.size(); ++i) {
+    const bool turns = path[i + 1].x - path[i].x != path[i].x - path[i - 1].x ||
+                       path[i + 1].y - path[i].y != path[i].y - path[i - 1].y;
+    if (!turns) continue;
+    if (previous != out.back() && !lineOfSight(grid, out.back(), path[i])) out.push_back(previous);
+    previous = path[i];
+  }
+  if (previous != out.back() && !lineOfSight(grid, out.back(), path.back())) out.push_back(previous);
+  out.push_back(path.back());
+}
+
+/// A point on a smoothed path, in cells or in world units, heading in radians.
+struct PathPose {
+  float x = 0.0f;
+  float y = 0.0f;
+  float theta = 0.0f;
+};
+
+/// Converts a pose from cell coordinates to the map frame in meters.
+inline PathPose toWorld(const gridmap::MapMetaData &metaData, const PathPose &pose) {
+  return {metaData.origin_x + pose.x * metaData.resolution, metaData.origin_y + pose.y * metaData.resolution,
+          pose.theta};
+}
+
+struct SmoothingParams {
+  float maxTurnPerPose = 0.15f; // Radians the heading may turn between two output poses
+  float tangentScale = 1.0f;    // Tangent length relative to the shorter adjacent leg
+  int refinements = 4;          // Tangent halvings before a blocked curve falls back to its chord
+};
+
+/** Path post-processing: string pulling, then a heading-aware Hermite spline.
+ *
+ * The shortcut waypoints are joined by cubic Hermite segments. Inner
+ * tangents follow the bisector of the adjacent legs, the end tangents
+ * follow the start and goal headings when given. A segment whose curve
+ * would cross a blocked cell has its tangents halved until it is clear,
+ * and ends up as the straight chord, which the shortcut step already
+ * checked. Each segment is emitted with as few poses as keep the heading
+ * change between two poses below `maxTurnPerPose`, so straight legs cost
+ * two poses; consecutive poses are checked for line of sight, not just
+ * sampled.
+ *
+ * Output poses are in cell coordinates, see toWorld(). A PathSmoother
+ * keeps its scratch buffers between calls.
+ */
+class PathSmoother {
+public:
+  static constexpr float kFreeHeading = std::numeric_limits<float>::quiet_NaN();
+
+  explicit PathSmoother(const gridmap::OccupancyGrid &grid_, SmoothingParams params_ = SmoothingParams()) :
+    grid(grid_), params(params_) {}
+
+  /// Smooths a cell path; a heading of kFreeHeading leaves that end unconstrained.
+  void smooth(const std::vector<Point> &path, float startHeading, float goalHeading, std::vector<PathPose> &out) {
+    out.clear();
+    if (path.empty()) return;
+    shortcutPath(grid, path, waypoints);
+    const size_t count = waypoints.size();
+    if (count == 1) {
+      out.push_back({waypoints[0].x + 0.5f, waypoints[0].y + 0.5f, std::isnan(startHeading) ? 0.0f : startHeading});
+      return;
+    }
+
+    tangents.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+      if (i == 0 || i + 1 == count) {
+        const float heading = i == 0 ? startHeading : goalHeading;
+        const size_t a = i == 0 ? 0 : count - 2;
+        const Vec leg = center(waypoints[a + 1]) - center(waypoints[a]);
+        const float length = leg.length() * params.tangentScale;
+        tangents[i] = std::isnan(heading) ? leg * params.tangentScale :
+                                            Vec{std::cos(heading) * length, std::sin(heading) * length};
+      } else {
+        const Vec legIn = center(waypoints[i]) - center(waypoints[i - 1]);
+        const Vec legOut = center(waypoints[i + 1]) - center(waypoints[i]);
+        const Vec bisector = legIn.normalized() + legOut.normalized();
+        const float length = std::min(legIn.length(), legOut.length()) * params.tangentScale;
+        tangents[i] = bisector.normalized() * length;
+      }
+    }
+
+    for (size_t i = 0; i + 1 < count; ++i) {
+      const Vec p0 = center(waypoints[i]);
+      const Vec p1 = center(waypoints[i + 1]);
+      Vec m0 = tangents[i];
+      Vec m1 = tangents[i + 1];
+      bool clear = false;
+      for (int attempt = 0; attempt <= params.refinements && !clear; ++attempt) {
+        if (attempt == params.refinements) {
+          m0 = m1 = p1 - p0; // The chord
+        } else if (attempt > 0) {
+          m0 = m0 * 0.5f;
+          m1 = m1 * 0.5f;
+        }
+        sampleSegment(p0, m0, p1, m1);
+        clear = segmentClear();
+      }
+      // The first pose of a segment is the last one of the previous segment
+      out.insert(out.end(), samples.begin() + (i == 0 ? 0 : 1), samples.end());
+    }
+  }
+
+  /// smooth() followed by toWorld().
+  void smoothToWorld(const std::vector<Point> &path, float startHeading, float goalHeading,
+                     const gridmap::MapMetaData &metaData, std::vector<PathPose> &out) {
+    smooth(path, startHeading, goalHeading, out);
+    for (PathPose &pose : out) pose = toWorld(metaData, pose);
+  }
+
+  /// Waypoints left after string pulling in the last smooth() call.
+  const std::vector<Point> &shortcutWaypoints() const { return waypoints; }
+
+private:
+  struct Vec {
+    float x = 0.0f;
+    float y = 0.0f;
+
+    Vec operator+(const Vec &o) const { return {x + o.x, y + o.y}; }
+    Vec operator-(const Vec &o) const { return {x - o.x, y - o.y}; }
+    Vec operator*(float s) const { return {x * s, y * s}; }
+    float length() const { return std::hypot(x, y); }
+    Vec normalized() const {
+      const float l = length();
+      return l > 0.0f ? Vec{x / l, y / l} : Vec{};
+    }
+  };
+
+  const gridmap::OccupancyGrid &grid;
+  SmoothingParams params;
+  std::vector<Point> waypoints;
+  std::vector<Vec> tangents;
+  std::vector<PathPose> samples;
+
+  static Vec center(const Point &p) { return {p.x + 0.5f, p.y + 0.5f}; }
+
+  static float headingOf(const Vec &v) { return std::atan2(v.y, v.x); }
+
+  static float turn(float from, float to) {
+    constexpr float kPi = 3.14159265358979f;
+    float d = to - from;
+    while (d > kPi) d -= 2.0f * kPi;
+    while (d < -kPi) d += 2.0f * kPi;
+    return std::fabs(d);
+  }
+
+  /// Poses of one Hermite segment, enough of them to bound the heading change between neighbors.
+  void sampleSegment(const Vec &p0, const Vec &m0, const Vec &p1, const Vec &m1) {
+    auto position = [&](float t) {
+      const float t2 = t * t;
+      const float t3 = t2 * t;
+      return p0 * (2.0f * t3 - 3.0f * t2 + 1.0f) + m0 * (t3 - 2.0f * t2 + t) + p1 * (3.0f * t2 - 2.0f * t3) +
+             m1 * (t3 - t2);
+    };
+    auto derivative = [&](float t) {
+      const float t2 = t * t;
+      const Vec d = p0 * (6.0f * t2 - 6.0f * t) + m0 * (3.0f * t2 - 4.0f * t + 1.0f) + p1 * (6.0f * t - 6.0f * t2) +
+                    m1 * (3.0f * t2 - 2.0f * t);
+      return d.length() > 0.0f ? d : p1 - p0;
+    };
+
+    // Total heading change, estimated on a fixed fine sampling
+    constexpr int kProbe = 16;
+    float total = 0.0f;
+    float previous = headingOf(derivative(0.0f));
+    for (int k = 1; k <= kProbe; ++k) {
+      const float heading = headingOf(derivative(static_cast<float>(k) / kProbe));
+      total += turn(previous, heading);
+      previous = heading;
+    }
+    const int steps = std::max(1, static_cast<int>(std::ceil(total / params.maxTurnPerPose)));
+
+    samples.clear();
+    for (int k = 0; k <= steps; ++k) {
+      const float t = static_cast<float>(k) / static_cast<float>(steps);
+      const Vec p = position(t);
+      samples.push_back({p.x, p.y, headingOf(derivative(t))});
+    }
+  }
+
+  bool segmentClear() const {
+    for (size_t k = 1; k < samples.size(); ++k) {
+      if (!lineOfSight(grid, samples[k - 1].x, samples[k - 1].y, samples[k].x, samples[k].y)) return false;
+    }
+    return true;
+  }
+};
+
+} // namespace astar
+
+#endif // PATH_SMOOTHING_HPP_
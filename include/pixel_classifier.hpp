@@ -0,0 +1,245 @@
+#ifndef PIXEL_CLASSIFIER_HPP_
+#define PIXEL_CLASSIFIER_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GRIDMAP_PIXEL_X86 1
+#endif
+
+#include "map_info.hpp"
+#include "occupancy_grid.hpp"
+
+namespace gridmap {
+
+/// Instruction set used to classify pixels.
+enum class PixelKernel {
+  kScalar,
+  kSse2,
+  kAvx2,
+};
+
+inline const char *pixelKernelName(PixelKernel kernel) {
+  switch (kernel) {
+    case PixelKernel::kScalar: return "scalar";
+    case PixelKernel::kSse2: return "SSE2";
+    case PixelKernel::kAvx2: return "AVX2";
+  }
+  return "?";
+}
+
+/// Fastest kernel this CPU supports, checked at run time.
+inline PixelKernel bestPixelKernel() {
+#if GRIDMAP_PIXEL_X86 && (defined(__GNUC__) || defined(__clang__))
+  static const PixelKernel best = __builtin_cpu_supports("avx2") ? PixelKernel::kAvx2 : PixelKernel::kSse2;
+  return best;
+#else
+  return PixelKernel::kScalar;
+#endif
+}
+
+/** Maps 8-bit grayscale pixels to occupancy values the way map_server does.
+ *
+ * With `negate` unset a pixel p has occupancy probability (255 - p) / 255.
+ * Above `occupiedThresh` the cell is occupied (100), below `freeThresh`
+ * it is free (0). In between it is unknown (-1) in trinary mode and
+ * interpolated in scale mode. Raw mode takes the pixel value as is.
+ *
+ * Each pixel value maps to one cell value, so every mode goes through a
+ * 256-entry table. In trinary mode the occupied and the free pixel values
+ * are two contiguous ranges, which the SIMD kernels test with two unsigned
+ * range compares per vector.
+ */
+class PixelClassifier {
+public:
+  explicit PixelClassifier(const MapInfo &info = MapInfo()) {
+    for (int p = 0; p < 256; ++p) table[p] = classify(info, p);
+
+    ranged = true;
+    occupiedRange = findRange(OccupancyGrid::kOccupied);
+    freeRange = findRange(OccupancyGrid::kFree);
+    for (int p = 0; p < 256; ++p) {
+      const int8_t v = table[p];
+      const bool expected = occupiedRange.contains(p) ? v == OccupancyGrid::kOccupied :
+                            freeRange.contains(p) ? v == OccupancyGrid::kFree : v == OccupancyGrid::kUnknown;
+      ranged = ranged && expected;
+    }
+  }
+
+  int8_t operator()(uint8_t pixel) const { return table[pixel]; }
+
+  /** Converts `count` pixels into cells and free masks.
+   *
+   * Bit i of masks[k] is set if cell 64 * k + i is free; bits past `count`
+   * are clear. `masks` needs room for (count + 63) / 64 words.
+   */
+  void convert(const uint8_t *pixels, size_t count, int8_t *cells, uint64_t *masks,
+               PixelKernel kernel = bestPixelKernel()) const {
+    size_t done = 0;
+#if GRIDMAP_PIXEL_X86
+    if (ranged && kernel == PixelKernel::kAvx2) {
+      done = convertAvx2(pixels, count, cells, masks);
+    } else if (ranged && kernel == PixelKernel::kSse2) {
+      done = convertSse2(pixels, count, cells, masks);
+    }
+#else
+    (void)kernel;
+#endif
+    convertScalar(pixels + done, count - done, cells + done, masks + done / 64);
+  }
+
+  /** Fills row y of `grid`, both layers, from `grid.width()` pixels.
+   *
+   * `masks` is scratch space of at least (width + 63) / 64 words. Call
+   * grid.finishBulkWrite() after the last row.
+   */
+  void convertRow(const uint8_t *pixels, int y, OccupancyGrid &grid, uint64_t *masks,
+                  PixelKernel kernel = bestPixelKernel()) const {
+    const size_t width = static_cast<size_t>(grid.width());
+    convert(pixels, width, grid.mutableData() + grid.index(0, y), masks, kernel);
+
+    // Cell x lives at bit x + 1 of the row, after the guard bit
+    const size_t maskWords = (width + 63) / 64;
+    uint64_t *bits = grid.mutablePassableRow(y);
+    uint64_t carry = 0;
+    for (size_t k = 0; k < grid.wordsPerRow(); ++k) {
+      const uint64_t mask = k < maskWords ? masks[k] : 0;
+      bits[k] = (mask << 1) | carry;
+      carry = mask >> 63;
+    }
+  }
+
+private:
+  struct Range {
+    int first = 1; // Empty by default
+    int last = 0;
+
+    bool empty() const { return last < first; }
+    bool contains(int p) const { return p >= first && p <= last; }
+  };
+
+  std::array<int8_t, 256> table{};
+  Range occupiedRange;
+  Range freeRange;
+  bool ranged = false; // Table is fully described by the two ranges
+
+  static int8_t classify(const MapInfo &info, int pixel) {
+    if (info.mode == MapMode::kRaw) {
+      return pixel <= OccupancyGrid::kOccupied ? static_cast<int8_t>(pixel) : OccupancyGrid::kUnknown;
+    }
+    const double occupancy = static_cast<double>(info.negate ? pixel : 255 - pixel) / 255.0;
+    if (occupancy > info.occupiedThresh) return OccupancyGrid::kOccupied;
+    if (occupancy < info.freeThresh) return OccupancyGrid::kFree;
+    if (info.mode == MapMode::kTrinary) return OccupancyGrid::kUnknown;
+    const double ratio = (occupancy - info.freeThresh) / (info.occupiedThresh - info.freeThresh);
+    return static_cast<int8_t>(std::rint(1.0 + 98.0 * ratio));
+  }
+
+  Range findRange(int8_t value) const {
+    Range range;
+    for (int p = 0; p < 256; ++p) {
+      if (table[p] != value) continue;
+      if (range.empty()) range.first = p;
+      range.last = p;
+    }
+    return range;
+  }
+
+  void convertScalar(const uint8_t *pixels, size_t count, int8_t *cells, uint64_t *masks) const {
+    for (size_t block = 0; block < count; block += 64) {
+      const size_t end = std::min(count, block + 64);
+      uint64_t mask = 0;
+      for (size_t i = block; i < end; ++i) {
+        const int8_t v = table[pixels[i]];
+        cells[i] = v;
+        mask |= static_cast<uint64_t>(OccupancyGrid::isFreeValue(v)) << (i - block);
+      }
+      masks[block / 64] = mask;
+    }
+  }
+
+#if GRIDMAP_PIXEL_X86
+  /// Lower bound and span of a range as bytes; an empty range gets a zero enable mask.
+  struct RangeBytes {
+    char first;
+    char span;
+    char enable;
+  };
+
+  static RangeBytes bytes(const Range &range) {
+    if (range.empty()) return {0, 0, 0};
+    return {static_cast<char>(range.first), static_cast<char>(range.last - range.first), static_cast<char>(-1)};
+  }
+
+  /// Full 64-pixel blocks only; returns how many pixels were converted.
+  size_t convertSse2(const uint8_t *pixels, size_t count, int8_t *cells, uint64_t *masks) const {
+    const RangeBytes o = bytes(occupiedRange);
+    const RangeBytes f = bytes(freeRange);
+    const __m128i oFirst = _mm_set1_epi8(o.first), oSpan = _mm_set1_epi8(o.span), oEnable = _mm_set1_epi8(o.enable);
+    const __m128i fFirst = _mm_set1_epi8(f.first), fSpan = _mm_set1_epi8(f.span), fEnable = _mm_set1_epi8(f.enable);
+    const __m128i occupiedValue = _mm_set1_epi8(OccupancyGrid::kOccupied);
+    const __m128i unknownValue = _mm_set1_epi8(OccupancyGrid::kUnknown);
+
+    const size_t blocks = count / 64;
+    for (size_t b = 0; b < blocks; ++b) {
+      uint64_t mask = 0;
+      for (int part = 0; part < 4; ++part) {
+        const size_t i = b * 64 + static_cast<size_t>(part) * 16;
+        const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+        // p in [first, first + span] <=> (p - first) as unsigned <= span
+        const __m128i od = _mm_sub_epi8(p, oFirst);
+        const __m128i fd = _mm_sub_epi8(p, fFirst);
+        const __m128i isOccupied = _mm_and_si128(_mm_cmpeq_epi8(_mm_min_epu8(od, oSpan), od), oEnable);
+        const __m128i isFree = _mm_and_si128(_mm_cmpeq_epi8(_mm_min_epu8(fd, fSpan), fd), fEnable);
+        const __m128i out = _mm_or_si128(_mm_and_si128(isOccupied, occupiedValue),
+                                         _mm_andnot_si128(_mm_or_si128(isOccupied, isFree), unknownValue));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(cells + i), out);
+        mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(isFree))) << (part * 16);
+      }
+      masks[b] = mask;
+    }
+    return blocks * 64;
+  }
+
+  /// As convertSse2(), 32 pixels per vector; only called if the CPU has AVX2.
+  __attribute__((target("avx2")))
+  size_t convertAvx2(const uint8_t *pixels, size_t count, int8_t *cells, uint64_t *masks) const {
+    const RangeBytes o = bytes(occupiedRange);
+    const RangeBytes f = bytes(freeRange);
+    const __m256i oFirst = _mm256_set1_epi8(o.first), oSpan = _mm256_set1_epi8(o.span);
+    const __m256i oEnable = _mm256_set1_epi8(o.enable);
+    const __m256i fFirst = _mm256_set1_epi8(f.first), fSpan = _mm256_set1_epi8(f.span);
+    const __m256i fEnable = _mm256_set1_epi8(f.enable);
+    const __m256i occupiedValue = _mm256_set1_epi8(OccupancyGrid::kOccupied);
+    const __m256i unknownValue = _mm256_set1_epi8(OccupancyGrid::kUnknown);
+
+    const size_t blocks = count / 64;
+    for (size_t b = 0; b < blocks; ++b) {
+      uint64_t mask = 0;
+      for (int part = 0; part < 2; ++part) {
+        const size_t i = b * 64 + static_cast<size_t>(part) * 32;
+        const __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels + i));
+        const __m256i od = _mm256_sub_epi8(p, oFirst);
+        const __m256i fd = _mm256_sub_epi8(p, fFirst);
+        const __m256i isOccupied = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(od, oSpan), od), oEnable);
+        const __m256i isFree = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(fd, fSpan), fd), fEnable);
+        const __m256i out = _mm256_or_si256(_mm256_and_si256(isOccupied, occupiedValue),
+                                            _mm256_andnot_si256(_mm256_or_si256(isOccupied, isFree), unknownValue));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(cells + i), out);
+        mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(isFree))) << (part * 32);
+      }
+      masks[b] = mask;
+    }
+    return blocks * 64;
+  }
+#endif
+};
+
+} // namespace gridmap
+
+#endif // PIXEL_CLASSIFIER_HPP_
@@ -0,0 +1,76 @@
+#ifndef PLANNING_SERVICE_HPP_
+#define PLANNING_SERVICE_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "a_star.hpp"
+#include "grid_planner.hpp"
+#include "occupancy_grid.hpp"
+#include "search_workspace.hpp"
+
+namespace astar {
+
+/// Inputs that fully determine a planning result.
+struct PlanKey {
+  Point start;
+  Point goal;
+  uint64_t mapVersion = 0;
+  Algorithm algorithm = Algorithm::kAStar;
+  float startHeading = 0.0f; // Only the lattice search plans for headings; 0 for the others
+  float goalHeading = 0.0f;
+
+  bool operator==(const PlanKey &o) const {
+    return start == o.start && goal == o.goal && mapVersion == o.mapVersion &&
+           algorithm == o.algorithm && startHeading == o.startHeading && goalHeading == o.goalHeading;
+  }
+
+  bool operator!=(const PlanKey &o) const {
+    return !(*this == o);
+  }
+};
+
+/** Caches the last path and replans only when one of its inputs changed.
+ *
+ * Meant to be called every frame: as long as the start cell, the goal cell,
+ * the algorithm and the grid version stay the same, plan() returns the cached
+ * path without searching.
+ */
+class PlanningService {
+public:
+  explicit PlanningService(const gridmap::OccupancyGrid &grid_) :
+    grid(grid_), planner(grid_) {}
+
+  const std::vector<Point> &plan(const Point &start, const Point &goal,
+                                 Algorithm algorithm = Algorithm::kAStar) {
+    const PlanKey key{start, goal, grid.version(), algorithm};
+    if (hasPlan && key == lastKey) return cachedPath;
+
+    planner.findPath(algorithm, start, goal, workspace, cachedPath);
+    lastKey = key;
+    hasPlan = true;
+    ++invocationCount;
+    return cachedPath;
+  }
+
+  /// Forces the next plan() call to search again.
+  void invalidate() { hasPlan = false; }
+
+  const std::vector<Point> &path() const { return cachedPath; }
+  const PlanKey &key() const { return lastKey; }
+  uint64_t invocations() const { return invocationCount; }
+  size_t lastExpanded() const { return workspace.expanded(); }
+
+private:
+  const gridmap::OccupancyGrid &grid;
+  GridPlanner planner;
+  SearchWorkspace workspace;
+  std::vector<Point> cachedPath;
+  PlanKey lastKey;
+  bool hasPlan = false;
+  uint64_t invocationCount = 0;
+};
+
+} // namespace astar
+
+#endif // PLANNING_SERVICE_HPP_
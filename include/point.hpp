@@ -0,0 +1,39 @@
+#ifndef POINT_HPP_
+#define POINT_HPP_
+
+#include <cstddef>
+#include <functional>
+
+namespace astar {
+
+class Point {
+public:
+  int x, y;
+
+  Point(int x_ = 0, int y_ = 0) : x(x_), y(y_) {}
+
+  bool operator==(const Point &o) const {
+    return x == o.x && y == o.y;
+  }
+
+  bool operator!=(const Point &o) const {
+    return !(*this == o);
+  }
+
+  bool operator<(const Point &o) const {
+    return x < o.x || (x == o.x && y < o.y);
+  }
+};
+
+} // namespace astar
+
+namespace std {
+  template <>
+  struct hash<astar::Point> {
+    size_t operator()(const astar::Point &p) const {
+      return hash<long long>()((static_cast<long long>(p.x) << 32) | static_cast<unsigned>(p.y));
+    }
+  };
+}
+
+#endif // POINT_HPP_
@@ -0,0 +1,326 @@
+#ifndef QUERY_TRACE_HPP_
+#define QUERY_TRACE_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "grid_planner.hpp"
+#include "occupancy_grid.hpp"
+#include "planning_service.hpp"
+
+namespace astar {
+
+namespace detail {
+
+constexpr uint32_t kTraceMagic = 0x52545147; // "GQTR"
+constexpr uint32_t kTraceFormat = 1;
+constexpr size_t kTraceBuffer = 1u << 20;
+
+struct TraceHeader {
+  uint32_t magic;
+  uint32_t format;
+  int32_t width;
+  int32_t height;
+  uint64_t mapHash;    // passabilityHash() of the map the trace starts from
+  uint64_t mapVersion; // OccupancyGrid::version() when recording started
+  uint32_t mapPathLength; // Followed by the map path, not terminated
+  uint32_t reserved;
+};
+
+struct TraceRecordHeader {
+  uint32_t kind;
+  uint32_t size; // Payload bytes that follow
+  uint64_t micros; // Since recording started
+};
+
+} // namespace detail
+
+enum class TraceRecordKind : uint32_t {
+  kPose = 1,  // TracePose
+  kQuery = 2, // TraceQuery
+  kCells = 3, // TraceCells, then `count` TraceCell
+  kMap = 4,   // TraceCells with `count` = cell count, then the int8 value of every cell
+};
+
+/// A start or goal pose set by the user, in continuous cell coordinates.
+struct TracePose {
+  uint32_t goal; // 0 for the start pose
+  float x;
+  float y;
+  float heading;
+};
+
+/// One finished query: its inputs and what the recording build returned.
+struct TraceQuery {
+  uint64_t mapVersion; // PlanKey::mapVersion, in the recording's numbering
+  uint32_t algorithm;
+  uint32_t found;
+  int32_t startX;
+  int32_t startY;
+  int32_t goalX;
+  int32_t goalY;
+  float startHeading;
+  float goalHeading;
+  uint32_t pathLength;
+  uint32_t reserved;
+  uint64_t expanded;
+  double milliseconds;
+
+  PlanKey key() const {
+    return {Point(startX, startY), Point(goalX, goalY), mapVersion, static_cast<Algorithm>(algorithm), startHeading,
+            goalHeading};
+  }
+};
+
+/// Cells changed since the previous TraceCells; `mapVersion` is the version after the change.
+struct TraceCells {
+  uint64_t mapVersion;
+  uint32_t count;
+  uint32_t reserved;
+};
+
+struct TraceCell {
+  int32_t index;
+  int32_t value;
+};
+
+/** Records planner queries and map changes to a binary trace file.
+ *
+ * The header names the map by path and passability hash. Each record is a
+ * small header (kind, payload size, microseconds since open()) and a fixed
+ * payload, written through a buffered stream in native byte order. Map
+ * edits are taken from the grid's change journal: recordChanges() writes
+ * the cells changed since the last call, or the whole map if the journal
+ * no longer reaches back that far, so a replay can rebuild the map every
+ * query ran on. Not thread-safe.
+ */
+class TraceWriter {
+public:
+  TraceWriter() = default;
+  TraceWriter(const TraceWriter &) = delete;
+  TraceWriter &operator=(const TraceWriter &) = delete;
+
+  ~TraceWriter() { close(); }
+
+  /// Starts a trace of `grid`, which was loaded from `mapPath`; false if the file cannot be written.
+  bool open(const std::string &path, const gridmap::OccupancyGrid &grid, const std::string &mapPath) {
+    close();
+    buffer.resize(detail::kTraceBuffer);
+    file.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+
+    detail::TraceHeader header{};
+    header.magic = detail::kTraceMagic;
+    header.format = detail::kTraceFormat;
+    header.width = grid.width();
+    header.height = grid.height();
+    header.mapHash = gridmap::passabilityHash(grid);
+    header.mapVersion = grid.version();
+    header.mapPathLength = static_cast<uint32_t>(mapPath.size());
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(mapPath.data(), static_cast<std::streamsize>(mapPath.size()));
+    begin = std::chrono::steady_clock::now();
+    loggedVersion = grid.version();
+    recordCount = 0;
+    return static_cast<bool>(file);
+  }
+
+  bool isOpen() const { return file.is_open(); }
+
+  void recordPose(bool goal, float x, float y, float heading) {
+    if (!isOpen()) return;
+    const TracePose pose{goal ? 1u : 0u, x, y, heading};
+    writeRecord(TraceRecordKind::kPose, &pose, sizeof(pose));
+  }
+
+  /// A query and its outcome.
+  void recordQuery(const PlanKey &key, bool found, size_t pathLength, size_t expanded, double milliseconds) {
+    if (!isOpen()) return;
+    TraceQuery query{};
+    query.mapVersion = key.mapVersion;
+    query.algorithm = static_cast<uint32_t>(key.algorithm);
+    query.found = found ? 1u : 0u;
+    query.startX = key.start.x;
+    query.startY = key.start.y;
+    query.goalX = key.goal.x;
+    query.goalY = key.goal.y;
+    query.startHeading = key.startHeading;
+    query.goalHeading = key.goalHeading;
+    query.pathLength = static_cast<uint32_t>(pathLength);
+    query.expanded = expanded;
+    query.milliseconds = milliseconds;
+    writeRecord(TraceRecordKind::kQuery, &query, sizeof(query));
+  }
+
+  /// Logs the cells `grid` changed since the last call, or since open().
+  void recordChanges(const gridmap::OccupancyGrid &grid) {
+    if (!isOpen() || grid.version() == loggedVersion) return;
+    changed.clear();
+    TraceCells cells{grid.version(), 0, 0};
+    if (grid.changesSince(loggedVersion, changed)) {
+      // The journal lists a cell once per change; its current value is all a replay needs
+      cells.count = static_cast<uint32_t>(changed.size());
+      writeHeader(TraceRecordKind::kCells, sizeof(cells) + changed.size() * sizeof(TraceCell));
+      file.write(reinterpret_cast<const char *>(&cells), sizeof(cells));
+      for (const int32_t index : changed) {
+        const TraceCell cell{index, grid.value(index % grid.width(), index / grid.width())};
+        file.write(reinterpret_cast<const char *>(&cell), sizeof(cell));
+      }
+    } else {
+      cells.count = static_cast<uint32_t>(grid.cellCount());
+      writeHeader(TraceRecordKind::kMap, sizeof(cells) + grid.cellCount());
+      file.write(reinterpret_cast<const char *>(&cells), sizeof(cells));
+      file.write(reinterpret_cast<const char *>(grid.data()), static_cast<std::streamsize>(grid.cellCount()));
+    }
+    ++recordCount;
+    loggedVersion = grid.version();
+  }
+
+  size_t records() const { return recordCount; }
+
+  void flush() {
+    if (isOpen()) file.flush();
+  }
+
+  void close() {
+    if (isOpen()) file.close();
+  }
+
+private:
+  std::vector<char> buffer;
+  std::ofstream file;
+  std::chrono::steady_clock::time_point begin;
+  uint64_t loggedVersion = 0;
+  size_t recordCount = 0;
+  std::vector<int32_t> changed;
+
+  void writeHeader(TraceRecordKind kind, size_t size) {
+    const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin);
+    const detail::TraceRecordHeader header{static_cast<uint32_t>(kind), static_cast<uint32_t>(size),
+                                           static_cast<uint64_t>(micros.count())};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  }
+
+  void writeRecord(TraceRecordKind kind, const void *payload, size_t size) {
+    writeHeader(kind, size);
+    file.write(static_cast<const char *>(payload), static_cast<std::streamsize>(size));
+    ++recordCount;
+  }
+};
+
+/// One record as read back; only the members of its kind are set.
+struct TraceEvent {
+  TraceRecordKind kind = TraceRecordKind::kPose;
+  uint64_t micros = 0;
+  TracePose pose{};
+  TraceQuery query{};
+  TraceCells cells{};
+  std::vector<TraceCell> changedCells; // kCells
+  std::vector<int8_t> map;             // kMap
+};
+
+/** Reads a trace written by TraceWriter one record at a time.
+ *
+ * Only the current record is held in memory, so traces of any length
+ * stream in constant memory. Records of kinds this reader does not know
+ * are skipped.
+ */
+class TraceReader {
+public:
+  TraceReader() = default;
+  TraceReader(const TraceReader &) = delete;
+  TraceReader &operator=(const TraceReader &) = delete;
+
+  /// False if the file is missing, truncated or of another format.
+  bool open(const std::string &path) {
+    buffer.resize(detail::kTraceBuffer);
+    file.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.open(path, std::ios::binary);
+    if (!file.read(reinterpret_cast<char *>(&traceHeader), sizeof(traceHeader))) return false;
+    if (traceHeader.magic != detail::kTraceMagic || traceHeader.format != detail::kTraceFormat ||
+        traceHeader.width <= 0 || traceHeader.height <= 0) {
+      return false;
+    }
+    mapFile.resize(traceHeader.mapPathLength);
+    return static_cast<bool>(file.read(&mapFile[0], static_cast<std::streamsize>(mapFile.size())));
+  }
+
+  int width() const { return traceHeader.width; }
+  int height() const { return traceHeader.height; }
+  uint64_t mapHash() const { return traceHeader.mapHash; }
+  uint64_t mapVersion() const { return traceHeader.mapVersion; }
+  const std::string &mapPath() const { return mapFile; }
+
+  /// The next record; false at the end of the trace or at a truncated record, see truncated().
+  bool next(TraceEvent &event) {
+    detail::TraceRecordHeader header;
+    while (file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+      event.kind = static_cast<TraceRecordKind>(header.kind);
+      event.micros = header.micros;
+      switch (event.kind) {
+        case TraceRecordKind::kPose:
+          if (!readPayload(header.size, &event.pose, sizeof(event.pose))) return false;
+          return true;
+        case TraceRecordKind::kQuery:
+          if (!readPayload(header.size, &event.query, sizeof(event.query))) return false;
+          return true;
+        case TraceRecordKind::kCells:
+          if (header.size < sizeof(event.cells) || !read(&event.cells, sizeof(event.cells)) ||
+              header.size != sizeof(event.cells) + event.cells.count * sizeof(TraceCell)) {
+            return fail();
+          }
+          event.changedCells.resize(event.cells.count);
+          return read(event.changedCells.data(), event.cells.count * sizeof(TraceCell)) || fail();
+        case TraceRecordKind::kMap:
+          if (header.size < sizeof(event.cells) || !read(&event.cells, sizeof(event.cells)) ||
+              header.size != sizeof(event.cells) + event.cells.count ||
+              event.cells.count != static_cast<size_t>(traceHeader.width) * static_cast<size_t>(traceHeader.height)) {
+            return fail();
+          }
+          event.map.resize(event.cells.count);
+          return read(event.map.data(), event.cells.count) || fail();
+        default:
+          if (!file.seekg(header.size, std::ios::cur)) return fail(); // Kinds from newer writers
+          break;
+      }
+    }
+    // A partial record header at the end is a truncated write
+    if (file.gcount() != 0) return fail();
+    return false;
+  }
+
+  /// Whether next() stopped at a damaged or incomplete record rather than at the end.
+  bool truncated() const { return damaged; }
+
+private:
+  std::vector<char> buffer;
+  std::ifstream file;
+  detail::TraceHeader traceHeader{};
+  std::string mapFile;
+  bool damaged = false;
+
+  bool read(void *data, size_t size) {
+    return static_cast<bool>(file.read(static_cast<char *>(data), static_cast<std::streamsize>(size)));
+  }
+
+  bool fail() {
+    damaged = true;
+    return false;
+  }
+
+  /// A fixed payload; a longer one from a newer writer is read up to `size` bytes and the rest skipped.
+  bool readPayload(uint32_t recordSize, void *data, size_t size) {
+    if (recordSize < size || !read(data, size)) return fail();
+    if (recordSize > size && !file.seekg(recordSize - size, std::ios::cur)) return fail();
+    return true;
+  }
+};
+
+} // namespace astar
+
+#endif // QUERY_TRACE_HPP_
@@ -0,0 +1,115 @@
+#ifndef SEARCH_STATS_HPP_
+#define SEARCH_STATS_HPP_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "search_workspace.hpp"
+
+namespace astar {
+
+/// Parts of a query that are timed separately.
+enum class SearchPhase {
+  kSetup,  // Workspace preparation and seeding the open list
+  kExpand, // Main loop
+  kPath,   // Walking the parents back from the goal
+};
+
+constexpr size_t kSearchPhaseCount = 3;
+
+inline const char *searchPhaseName(SearchPhase phase) {
+  switch (phase) {
+    case SearchPhase::kSetup: return "setup";
+    case SearchPhase::kExpand: return "expand";
+    case SearchPhase::kPath: return "path";
+  }
+  return "?";
+}
+
+/// What one query did, as collected by SearchStatsHooks.
+struct SearchStats {
+  size_t expanded = 0;
+  size_t pushes = 0;
+  size_t duplicatePushes = 0; // Pushes for a node already queued: a decrease-key or a duplicate entry
+  size_t stalePops = 0;       // Entries popped after their node was closed
+  size_t openPeak = 0;        // Largest open list size, stale entries included
+  size_t bytesAllocated = 0;  // Growth of the workspace during the query
+  std::array<double, kSearchPhaseCount> phaseMilliseconds{};
+
+  double milliseconds() const { return phaseMilliseconds[0] + phaseMilliseconds[1] + phaseMilliseconds[2]; }
+};
+
+/** Search hooks that do nothing; the default for every planner.
+ *
+ * Searches take the hooks as a template parameter and call them at fixed
+ * points of their main loop. With this type every call is an empty inline
+ * function, so an uninstrumented search compiles to the same code as one
+ * without hooks.
+ */
+struct NoSearchHooks {
+  void begin(const SearchWorkspace &) {}
+  void phase(SearchPhase) {}
+  void push(bool /*duplicate*/, size_t /*openSize*/) {}
+  void expand(int32_t /*index*/) {}
+  void stalePop() {}
+  void end(const SearchWorkspace &) {}
+};
+
+/** Hooks that fill a SearchStats and optionally record the expanded cells.
+ *
+ * One instance serves one query at a time. `expandedCells`, if set, receives
+ * the index of every expanded cell in expansion order.
+ */
+class SearchStatsHooks {
+public:
+  SearchStats stats;
+  std::vector<int32_t> *expandedCells = nullptr;
+
+  void begin(const SearchWorkspace &workspace) {
+    stats = SearchStats();
+    if (expandedCells != nullptr) expandedCells->clear();
+    bytesBefore = workspace.bytesReserved();
+    current = SearchPhase::kSetup;
+    mark = Clock::now();
+  }
+
+  void phase(SearchPhase next) {
+    const Clock::time_point now = Clock::now();
+    stats.phaseMilliseconds[static_cast<size_t>(current)] += std::chrono::duration<double, std::milli>(now - mark).count();
+    current = next;
+    mark = now;
+  }
+
+  void push(bool duplicate, size_t openSize) {
+    ++stats.pushes;
+    stats.duplicatePushes += duplicate;
+    if (openSize > stats.openPeak) stats.openPeak = openSize;
+  }
+
+  void expand(int32_t index) {
+    ++stats.expanded;
+    if (expandedCells != nullptr) expandedCells->push_back(index);
+  }
+
+  void stalePop() { ++stats.stalePops; }
+
+  void end(const SearchWorkspace &workspace) {
+    phase(current);
+    const size_t bytesAfter = workspace.bytesReserved();
+    stats.bytesAllocated = bytesAfter > bytesBefore ? bytesAfter - bytesBefore : 0;
+  }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  Clock::time_point mark;
+  SearchPhase current = SearchPhase::kSetup;
+  size_t bytesBefore = 0;
+};
+
+} // namespace astar
+
+#endif // SEARCH_STATS_HPP_
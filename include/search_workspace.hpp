@@ -0,0 +1,188 @@
+#ifndef SEARCH_WORKSPACE_HPP_
+#define SEARCH_WORKSPACE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace astar {
+
+/// Searches poll their cancel flag once every kCancelCheckMask + 1 expansions.
+constexpr size_t kCancelCheckMask = 1023;
+
+/// Whether the optional cancel flag is set.
+inline bool cancelRequested(const std::atomic<bool> *cancel) {
+  return cancel != nullptr && cancel->load(std::memory_order_relaxed);
+}
+
+/// cancelRequested() polled only at every (kCancelCheckMask + 1)-th of `expanded`, to keep it off the hot path.
+inline bool cancelRequested(const std::atomic<bool> *cancel, size_t expanded) {
+  return (expanded & kCancelCheckMask) == 0 && cancelRequested(cancel);
+}
+
+/** Reusable per-query search state.
+ *
+ * Node records are indexed by y*width+x and live in pages of kPageSize
+ * records that are allocated the first time a search touches them, so
+ * memory follows the area searched rather than the map size; that keeps
+ * searches on large tiled maps affordable. Every record carries the
+ * generation of the query that last touched it, so starting a new query
+ * only bumps a counter instead of clearing anything. Once the workspace has
+ * seen a map of a given size, further queries over the same area allocate
+ * nothing.
+ *
+ * pushOpen()/popOpen() are a binary heap with lazy deletion: improving a
+ * queued node pushes a second entry and the stale one is skipped when
+ * popped. The open lists in open_list.hpp keep their entries in the same
+ * storage, see openEntries() and openBuckets().
+ */
+class SearchWorkspace {
+public:
+  enum class State : uint8_t { kUnvisited, kOpen, kClosed };
+
+  struct NodeRecord {
+    float gCost = 0.0f;
+    int32_t parent = -1;
+    uint32_t generation = 0;
+    int32_t heapIndex = -1; // Position in an indexed open list, -1 if not queued
+    State state = State::kUnvisited;
+  };
+
+  struct OpenEntry {
+    float fCost;
+    float hCost;
+    int32_t index;
+
+    /** Whether this entry is expanded first: lower tieKey(); among equal keys, the one closer to the goal.
+     *
+     * Paths of equal cost add up their straight and diagonal steps in
+     * different orders, so their float f costs differ in the last bits;
+     * compared exactly, the h tie-break would hardly ever apply and the
+     * search would widen over every equal-cost path. Comparing (key, h)
+     * instead is still a strict weak ordering. The search then expands by
+     * f rounded to within 2^-17 of itself, so a path costs at most a factor
+     * (1 + 2^-17) / (1 - 2^-17), about 1 + 1.5e-5, above the optimum.
+     */
+    bool before(const OpenEntry &other) const {
+      const uint32_t key = tieKey(fCost);
+      const uint32_t otherKey = tieKey(other.fCost);
+      if (key == otherKey) return hCost < other.hCost;
+      return key < otherKey;
+    }
+
+    /// A non-negative f with its last kTieBits mantissa bits rounded off; ordered like f.
+    static uint32_t tieKey(float f) {
+      uint32_t bits;
+      std::memcpy(&bits, &f, sizeof(bits));
+      return (bits + (uint32_t{1} << (kTieBits - 1))) >> kTieBits;
+    }
+  };
+
+  static constexpr int kTieBits = 7; // Neighboring keys are at most 2^-16 of f apart
+
+  static constexpr int kPageBits = 12;
+  static constexpr size_t kPageSize = size_t{1} << kPageBits;
+
+  void prepare(int width, int height) {
+    const size_t cellCount = static_cast<size_t>(width) * static_cast<size_t>(height);
+    if (cells != cellCount) {
+      cells = cellCount;
+      pages.clear();
+      pages.resize((cellCount + kPageSize - 1) / kPageSize);
+      pageCount = 0;
+      generation = 0;
+    }
+    if (++generation == 0) {
+      // Counter wrapped around: stale records could alias the new generation.
+      for (auto &page : pages) {
+        if (!page) continue;
+        for (size_t i = 0; i < kPageSize; ++i) page[i].generation = 0;
+      }
+      generation = 1;
+    }
+    openList.clear();
+    expandedCount = 0;
+  }
+
+  State state(int32_t index) const {
+    const NodeRecord *page = pages[static_cast<size_t>(index) >> kPageBits].get();
+    if (page == nullptr) return State::kUnvisited;
+    const NodeRecord &node = page[static_cast<size_t>(index) & (kPageSize - 1)];
+    return node.generation == generation ? node.state : State::kUnvisited;
+  }
+
+  /// Record of a node opened in the current query.
+  NodeRecord &node(int32_t index) { return pages[static_cast<size_t>(index) >> kPageBits][index & (kPageSize - 1)]; }
+  const NodeRecord &node(int32_t index) const {
+    return pages[static_cast<size_t>(index) >> kPageBits][index & (kPageSize - 1)];
+  }
+
+  /// Marks a node as discovered in the current query.
+  NodeRecord &open(int32_t index, float gCost, int32_t parent) {
+    std::unique_ptr<NodeRecord[]> &page = pages[static_cast<size_t>(index) >> kPageBits];
+    if (!page) {
+      page.reset(new NodeRecord[kPageSize]);
+      ++pageCount;
+    }
+    NodeRecord &node = page[index & (kPageSize - 1)];
+    if (node.generation != generation) node.heapIndex = -1;
+    node.gCost = gCost;
+    node.parent = parent;
+    node.generation = generation;
+    node.state = State::kOpen;
+    return node;
+  }
+
+  void pushOpen(float fCost, float hCost, int32_t index) {
+    openList.push_back({fCost, hCost, index});
+    std::push_heap(openList.begin(), openList.end(), CompareEntry());
+  }
+
+  OpenEntry popOpen() {
+    std::pop_heap(openList.begin(), openList.end(), CompareEntry());
+    OpenEntry entry = openList.back();
+    openList.pop_back();
+    return entry;
+  }
+
+  bool openEmpty() const { return openList.empty(); }
+  size_t openSize() const { return openList.size(); }
+
+  /// Entry storage for open lists other than pushOpen()/popOpen(); emptied by prepare().
+  std::vector<OpenEntry> &openEntries() { return openList; }
+
+  /// Bucket storage for BucketOpenList; it leaves all buckets empty when done.
+  std::vector<std::vector<OpenEntry>> &openBuckets() { return buckets; }
+
+  void countExpansion() { ++expandedCount; }
+  size_t expanded() const { return expandedCount; }
+
+  size_t bytesReserved() const {
+    size_t bytes = pageCount * kPageSize * sizeof(NodeRecord) + pages.capacity() * sizeof(pages[0]) +
+                   openList.capacity() * sizeof(OpenEntry) + buckets.capacity() * sizeof(buckets[0]);
+    for (const auto &bucket : buckets) bytes += bucket.capacity() * sizeof(OpenEntry);
+    return bytes;
+  }
+
+private:
+  struct CompareEntry {
+    bool operator()(const OpenEntry &lhs, const OpenEntry &rhs) const { return rhs.before(lhs); }
+  };
+
+  std::vector<std::unique_ptr<NodeRecord[]>> pages; // Null until touched
+  size_t pageCount = 0;
+  size_t cells = 0;
+  std::vector<OpenEntry> openList;
+  std::vector<std::vector<OpenEntry>> buckets;
+  uint32_t generation = 0;
+  size_t expandedCount = 0;
+};
+
+} // namespace astar
+
+#endif // SEARCH_WORKSPACE_HPP_
@@ -0,0 +1,97 @@
+#ifndef SQUARE_OVERLAY_HPP_
+#define SQUARE_OVERLAY_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "render_module/render_module.hpp"
+#include "tile_renderer.hpp"
+
+namespace gridmap {
+
+/** Many same-style squares drawn as one NanoVG path.
+ *
+ * Positions are kept as a struct of arrays with reserved capacity, so adding
+ * thousands of squares per frame does not reallocate. draw() culls against
+ * the view and emits every visible square into a single path that is filled
+ * once, instead of one BeginPath/Fill per square.
+ */
+class SquareOverlay {
+public:
+  explicit SquareOverlay(size_t capacity = 1 << 16) {
+    xs.reserve(capacity);
+    ys.reserve(capacity);
+  }
+
+  void add(float x, float y) {
+    if (xs.size() == xs.capacity()) {
+      xs.reserve(xs.capacity() * 2);
+      ys.reserve(ys.capacity() * 2);
+    }
+    xs.push_back(x);
+    ys.push_back(y);
+  }
+
+  void clear() {
+    xs.clear();
+    ys.clear();
+  }
+
+  size_t size() const { return xs.size(); }
+
+  /// Draws all squares of edge `edge` with their lower-left corner at the stored position.
+  void draw(const ViewWindow &view, float edge, NVGcolor color) {
+    const auto begin = std::chrono::steady_clock::now();
+    const float x0 = std::min(view.x0, view.x1) - edge;
+    const float y0 = std::min(view.y0, view.y1) - edge;
+    const float x1 = std::max(view.x0, view.x1);
+    const float y1 = std::max(view.y0, view.y1);
+
+    size_t visible = 0;
+    nvg::BeginPath();
+    for (size_t i = 0; i < xs.size(); ++i) {
+      const float x = xs[i];
+      const float y = ys[i];
+      if (x < x0 || x > x1 || y < y0 || y > y1) continue;
+      nvg::Rect(x, y, edge, edge);
+      ++visible;
+    }
+    if (visible > 0) {
+      nvg::FillColor(color);
+      nvg::Fill();
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    drawn = visible;
+    drawMs = std::chrono::duration<double, std::milli>(end - begin).count();
+    if (lastFrame != std::chrono::steady_clock::time_point{}) {
+      const double seconds = std::chrono::duration<double>(end - lastFrame).count();
+      if (seconds > 0.0) {
+        // Exponential moving averages keep the readout stable from frame to frame
+        frameMs += 0.1 * (seconds * 1000.0 - frameMs);
+        primitivesPerSecond += 0.1 * (static_cast<double>(visible) / seconds - primitivesPerSecond);
+      }
+    }
+    lastFrame = end;
+  }
+
+  size_t lastDrawn() const { return drawn; }
+  double lastDrawMilliseconds() const { return drawMs; }
+  double frameMilliseconds() const { return frameMs; }
+  double primitivesPerSec() const { return primitivesPerSecond; }
+
+private:
+  std::vector<float> xs;
+  std::vector<float> ys;
+
+  size_t drawn = 0;
+  double drawMs = 0.0;
+  double frameMs = 0.0;
+  double primitivesPerSecond = 0.0;
+  std::chrono::steady_clock::time_point lastFrame;
+};
+
+} // namespace gridmap
+
+#endif // SQUARE_OVERLAY_HPP_
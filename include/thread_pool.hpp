@@ -0,0 +1,156 @@
+#ifndef THREAD_POOL_HPP_
+#define THREAD_POOL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace astar {
+
+/** Fixed set of worker threads with per-worker queues and work stealing.
+ *
+ * parallelFor() cuts an index range into chunks and deals them round-robin
+ * to the worker queues. A worker pops from the back of its own queue and,
+ * once that is empty, steals from the front of the others, so uneven chunk
+ * costs (long and short path queries) still balance out. The body gets the
+ * worker id, which callers use to index per-worker scratch state.
+ *
+ * parallelFor() calls from several threads take turns; a call from inside
+ * one of the pool's own tasks would wait for itself.
+ */
+class ThreadPool {
+public:
+  explicit ThreadPool(unsigned threadCount = 0) {
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < threadCount; ++i) queues.push_back(std::make_unique<Queue>());
+    for (unsigned i = 0; i < threadCount; ++i) workers.emplace_back([this, i]() { run(i); });
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wakeup.notify_all();
+    for (auto &worker : workers) worker.join();
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+  /** The process-wide pool, one worker per hardware thread, started on first use.
+   *
+   * Costmaps, connected components, flow fields and landmark tables run on
+   * it unless given a pool of their own, so a program that keeps several
+   * of them still holds one set of mostly idle workers.
+   */
+  static ThreadPool &shared() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  /// Calls body(index, worker) for every index in [0, count) and blocks until all calls returned.
+  template <typename Body>
+  void parallelFor(size_t count, Body &&body, size_t grain = 1) {
+    if (count == 0) return;
+    grain = std::max<size_t>(1, grain);
+    std::lock_guard<std::mutex> submitLock(submitMutex);
+
+    const std::function<void(size_t, unsigned)> task = [&body](size_t i, unsigned worker) { body(i, worker); };
+    const size_t chunks = (count + grain - 1) / grain;
+    job = &task;
+    remaining.store(chunks, std::memory_order_relaxed);
+    for (size_t c = 0; c < chunks; ++c) {
+      Queue &queue = *queues[c % queues.size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.ranges.push_back({c * grain, std::min(count, (c + 1) * grain)});
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++generation;
+    }
+    wakeup.notify_all();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return remaining.load(std::memory_order_acquire) == 0; });
+    job = nullptr;
+  }
+
+private:
+  struct Range {
+    size_t begin;
+    size_t end;
+  };
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Range> ranges;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::mutex submitMutex;
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  std::condition_variable done;
+  const std::function<void(size_t, unsigned)> *job = nullptr;
+  std::atomic<size_t> remaining{0};
+  uint64_t generation = 0;
+  bool stopping = false;
+  std::vector<std::thread> workers; // Declared last so everything above exists when they start
+
+  bool take(unsigned id, Range &range) {
+    {
+      Queue &own = *queues[id];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.ranges.empty()) {
+        range = own.ranges.back();
+        own.ranges.pop_back();
+        return true;
+      }
+    }
+    for (size_t k = 1; k < queues.size(); ++k) {
+      Queue &victim = *queues[(id + k) % queues.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.ranges.empty()) {
+        range = victim.ranges.front();
+        victim.ranges.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void run(unsigned id) {
+    uint64_t seen = 0;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wakeup.wait(lock, [&]() { return stopping || generation != seen; });
+        if (stopping) return;
+        seen = generation;
+      }
+      Range range;
+      while (take(id, range)) {
+        for (size_t i = range.begin; i < range.end; ++i) (*job)(i, id);
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          std::lock_guard<std::mutex> lock(mutex);
+          done.notify_all();
+        }
+      }
+    }
+  }
+};
+
+} // namespace astar
+
+#endif // THREAD_POOL_HPP_
@@ -0,0 +1,297 @@
+#ifndef TILE_RENDERER_HPP_
+#define TILE_RENDERER_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "render_module/render_module.hpp"
+#include "layer_pyramid.hpp"
+#include "occupancy_grid.hpp"
+
+namespace gridmap {
+
+/// Part of the map currently visible in the ZoomView, in view units.
+struct ViewWindow {
+  float x0 = 0.0f;
+  float y0 = 0.0f;
+  float x1 = 0.0f;
+  float y1 = 0.0f;
+  float pixelsPerUnit = 1.0f; // screen pixels per view unit
+};
+
+/** Tiled, level-of-detail renderer for a one-byte-per-cell map layer.
+ *
+ * The layer is kept as a LayerPyramid. Each level is cut into square tiles of
+ * `tileSize` texels which are rasterized on the CPU into NanoVG images with
+ * nearest sampling, created lazily the first time they become visible.
+ * draw() picks the level whose texels are about one screen pixel, culls
+ * tiles outside the view and issues one textured rect per visible tile, so
+ * the cost depends on the viewport, not on the map size.
+ *
+ * Images are evicted least-recently-drawn first once more than `maxImages`
+ * exist. release() must be called while the NanoVG context is still alive.
+ *
+ * A streamed layer (setStreamedLayer()) keeps only the levels above 0 in
+ * memory and reads level 0 texels from the source when a tile is
+ * rasterized, e.g. through a TiledGridView over a TileStore.
+ */
+class TileRenderer {
+public:
+  /// RGBA per layer value, bytes in memory order r, g, b, a.
+  using Palette = std::array<std::array<uint8_t, 4>, 256>;
+
+  explicit TileRenderer(int tileSize_ = 256, size_t maxImages_ = 256) :
+    tileSize(tileSize_), maxImages(maxImages_),
+    scratch(static_cast<size_t>(tileSize_) * static_cast<size_t>(tileSize_) * 4) {}
+
+  /// Replaces the layer; `cellSize_` is the size of one cell in view units.
+  template <typename ValueFn>
+  void setLayer(int width, int height, float cellSize_, const Palette &palette_, ValueFn &&value) {
+    release();
+    layerWidth = width;
+    layerHeight = height;
+    cellSize = cellSize_;
+    palette = palette_;
+    baseValue = nullptr;
+    pyramid.build(width, height, tileSize, value);
+  }
+
+  /// Like setLayer(), but `value` is kept and read again for every level 0 tile that gets rasterized.
+  template <typename ValueFn>
+  void setStreamedLayer(int width, int height, float cellSize_, const Palette &palette_, ValueFn value) {
+    release();
+    layerWidth = width;
+    layerHeight = height;
+    cellSize = cellSize_;
+    palette = palette_;
+    baseValue = value;
+    pyramid.build(width, height, tileSize, value, false);
+  }
+
+  /// Re-reads the cells inside `cells` and re-rasterizes only the tiles covering them.
+  template <typename ValueFn>
+  void invalidate(const CellRect &cells, ValueFn &&value) {
+    pyramid.update(cells, value);
+    for (auto &entry : tiles) {
+      const int level = static_cast<int>(entry.first >> 48);
+      const int tx = static_cast<int>((entry.first >> 24) & 0xFFFFFF);
+      const int ty = static_cast<int>(entry.first & 0xFFFFFF);
+      const int span = tileSize << level;
+      const CellRect covered{tx * span, ty * span, (tx + 1) * span, (ty + 1) * span};
+      if (covered.intersects(cells)) entry.second.dirty = true;
+    }
+  }
+
+  /// Smallest level whose texels cover at least one screen pixel.
+  int levelFor(float pixelsPerCell) const {
+    int level = 0;
+    while (level + 1 < pyramid.levels() && pixelsPerCell * static_cast<float>(1 << level) < 1.0f) {
+      ++level;
+    }
+    return level;
+  }
+
+  void draw(const ViewWindow &view, float alpha = 1.0f) {
+    ++frame;
+    tilesDrawn = 0;
+    uploads = 0;
+    if (pyramid.levels() == 0) return;
+
+    const float pixelsPerCell = view.pixelsPerUnit * cellSize;
+    level = levelFor(pixelsPerCell);
+    const float tileExtent = cellSize * static_cast<float>(tileSize << level);
+    const float mapWidth = cellSize * static_cast<float>(layerWidth);
+    const float mapHeight = cellSize * static_cast<float>(layerHeight);
+
+    const float vx0 = std::max(std::min(view.x0, view.x1), 0.0f);
+    const float vy0 = std::max(std::min(view.y0, view.y1), 0.0f);
+    const float vx1 = std::min(std::max(view.x0, view.x1), mapWidth);
+    const float vy1 = std::min(std::max(view.y0, view.y1), mapHeight);
+    if (vx1 <= vx0 || vy1 <= vy0) return;
+
+    const int tx0 = static_cast<int>(vx0 / tileExtent);
+    const int ty0 = static_cast<int>(vy0 / tileExtent);
+    const int tx1 = static_cast<int>(std::ceil(vx1 / tileExtent));
+    const int ty1 = static_cast<int>(std::ceil(vy1 / tileExtent));
+
+    for (int ty = ty0; ty < ty1; ++ty) {
+      for (int tx = tx0; tx < tx1; ++tx) {
+        const int image = tileImage(level, tx, ty);
+        if (image == 0) continue;
+        const float x = static_cast<float>(tx) * tileExtent;
+        const float y = static_cast<float>(ty) * tileExtent;
+        nvg::BeginPath();
+        nvg::Rect(x, y, std::min(tileExtent, mapWidth - x), std::min(tileExtent, mapHeight - y));
+        nvg::FillPaint(nvg::ImagePattern(x, y, tileExtent, tileExtent, 0.0f, image, alpha));
+        nvg::Fill();
+        ++tilesDrawn;
+      }
+    }
+    evict();
+  }
+
+  /// Cell borders of the visible area, only once cells are at least `minPixelsPerCell` wide.
+  void drawGridLines(const ViewWindow &view, NVGcolor color, float minPixelsPerCell = 4.0f) const {
+    if (view.pixelsPerUnit * cellSize < minPixelsPerCell) return;
+    const int cx0 = std::max(0, static_cast<int>(std::min(view.x0, view.x1) / cellSize));
+    const int cy0 = std::max(0, static_cast<int>(std::min(view.y0, view.y1) / cellSize));
+    const int cx1 = std::min(layerWidth, static_cast<int>(std::ceil(std::max(view.x0, view.x1) / cellSize)));
+    const int cy1 = std::min(layerHeight, static_cast<int>(std::ceil(std::max(view.y0, view.y1) / cellSize)));
+    if (cx1 <= cx0 || cy1 <= cy0) return;
+
+    nvg::BeginPath();
+    for (int i = cx0; i <= cx1; ++i) {
+      nvg::MoveTo(i * cellSize, cy0 * cellSize);
+      nvg::LineTo(i * cellSize, cy1 * cellSize);
+    }
+    for (int i = cy0; i <= cy1; ++i) {
+      nvg::MoveTo(cx0 * cellSize, i * cellSize);
+      nvg::LineTo(cx1 * cellSize, i * cellSize);
+    }
+    nvg::StrokeColor(color);
+    nvg::StrokeWidth(0.8f / view.pixelsPerUnit);
+    nvg::Stroke();
+  }
+
+  /// Deletes every NanoVG image; the layer itself is kept.
+  void release() {
+    for (auto &entry : tiles) nvg::DeleteImage(entry.second.image);
+    tiles.clear();
+  }
+
+  int lastLevel() const { return level; }
+  size_t lastTilesDrawn() const { return tilesDrawn; }
+  size_t lastUploads() const { return uploads; }
+  size_t residentImages() const { return tiles.size(); }
+
+private:
+  struct Tile {
+    int image = 0;
+    uint64_t lastUsed = 0;
+    bool dirty = true;
+  };
+
+  int tileSize;
+  size_t maxImages;
+  int layerWidth = 0;
+  int layerHeight = 0;
+  float cellSize = 1.0f;
+  Palette palette{};
+  LayerPyramid pyramid;
+  std::function<uint8_t(int, int)> baseValue; // Level 0 source of a streamed layer
+  std::unordered_map<uint64_t, Tile> tiles;
+  std::vector<uint8_t> scratch;
+  uint64_t frame = 0;
+  int level = 0;
+  size_t tilesDrawn = 0;
+  size_t uploads = 0;
+
+  static uint64_t key(int level_, int tx, int ty) {
+    return (static_cast<uint64_t>(level_) << 48) | (static_cast<uint64_t>(tx) << 24) | static_cast<uint64_t>(ty);
+  }
+
+  int tileImage(int level_, int tx, int ty) {
+    Tile &tile = tiles[key(level_, tx, ty)];
+    tile.lastUsed = frame;
+    if (!tile.dirty) return tile.image;
+
+    // Texture row r holds cell row y0 + r, matching the y-up view.
+    const int x0 = tx * tileSize;
+    const int y0 = ty * tileSize;
+    const int w = pyramid.levelWidth(level_);
+    const int h = pyramid.levelHeight(level_);
+    for (int r = 0; r < tileSize; ++r) {
+      uint8_t *out = scratch.data() + static_cast<size_t>(r) * tileSize * 4;
+      const int y = y0 + r;
+      for (int c = 0; c < tileSize; ++c, out += 4) {
+        const int x = x0 + c;
+        if (x >= w || y >= h) {
+          out[0] = out[1] = out[2] = out[3] = 0;
+          continue;
+        }
+        const uint8_t value = (level_ == 0 && !pyramid.hasBase()) ? baseValue(x, y) : pyramid.value(level_, x, y);
+        const auto &rgba = palette[value];
+        std::copy(rgba.begin(), rgba.end(), out);
+      }
+    }
+
+    if (tile.image == 0) {
+      tile.image = nvg::CreateImageRGBA(tileSize, tileSize, NVG_IMAGE_NEAREST, scratch.data());
+    } else {
+      nvg::UpdateImage(tile.image, scratch.data());
+    }
+    tile.dirty = false;
+    ++uploads;
+    return tile.image;
+  }
+
+  void evict() {
+    while (tiles.size() > maxImages) {
+      auto oldest = tiles.end();
+      for (auto it = tiles.begin(); it != tiles.end(); ++it) {
+        if (it->second.lastUsed == frame) continue;
+        if (oldest == tiles.end() || it->second.lastUsed < oldest->second.lastUsed) oldest = it;
+      }
+      if (oldest == tiles.end()) return; // Everything is on screen
+      nvg::DeleteImage(oldest->second.image);
+      tiles.erase(oldest);
+    }
+  }
+};
+
+/// Palette and cell values for drawing an occupancy grid with TileRenderer.
+inline TileRenderer::Palette occupancyPalette() {
+  TileRenderer::Palette palette{};
+  palette[0] = {255, 255, 255, 255}; // free
+  palette[1] = {204, 204, 204, 255}; // unknown
+  palette[2] = {153, 153, 153, 255}; // occupied
+  return palette;
+}
+
+/// Heatmap for costmap_2d style costs: 0 transparent, 1..252 blue to red, 253 inscribed purple, 254 lethal clear.
+inline TileRenderer::Palette costmapPalette() {
+  TileRenderer::Palette palette{};
+  for (int c = 1; c <= 252; ++c) {
+    const float t = static_cast<float>(c) / 252.0f;
+    palette[c] = {static_cast<uint8_t>(255.0f * t), 64, static_cast<uint8_t>(255.0f * (1.0f - t)),
+                  static_cast<uint8_t>(60.0f + 120.0f * t)};
+  }
+  palette[253] = {160, 0, 200, 200};
+  return palette;
+}
+
+/// Search heatmap: 0 transparent, 1..255 from early (yellow) to late (red) in the expansion order.
+inline TileRenderer::Palette expansionPalette() {
+  TileRenderer::Palette palette{};
+  for (int c = 1; c <= 255; ++c) {
+    const float t = static_cast<float>(c - 1) / 254.0f;
+    palette[c] = {255, static_cast<uint8_t>(230.0f * (1.0f - t)), 0, static_cast<uint8_t>(90.0f + 90.0f * t)};
+  }
+  return palette;
+}
+
+/// Cost-to-goal gradient: 0 transparent, 1..255 from near the goal (green) to far (blue).
+inline TileRenderer::Palette flowFieldPalette() {
+  TileRenderer::Palette palette{};
+  for (int c = 1; c <= 255; ++c) {
+    const float t = static_cast<float>(c - 1) / 254.0f;
+    palette[c] = {static_cast<uint8_t>(40.0f + 40.0f * t), static_cast<uint8_t>(210.0f * (1.0f - t)),
+                  static_cast<uint8_t>(90.0f + 165.0f * t), 120};
+  }
+  return palette;
+}
+
+inline uint8_t occupancyLayerValue(const OccupancyGrid &grid, int x, int y) {
+  const int8_t value = grid.value(x, y);
+  if (value == OccupancyGrid::kUnknown) return 1;
+  return OccupancyGrid::isFreeValue(value) ? 0 : 2;
+}
+
+} // namespace gridmap
+
+#endif // TILE_RENDERER_HPP_
@@ -0,0 +1,357 @@
+#ifndef TILE_STORE_HPP_
+#define TILE_STORE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "map_info.hpp"
+#include "occupancy_grid.hpp"
+
+namespace gridmap {
+
+/** One square chunk of a tiled map.
+ *
+ * `cells` is a small OccupancyGrid in tile coordinates. Its guard bits are
+ * not blocked but hold the passability of the neighboring tiles' edge
+ * cells, so neighborhood queries at the tile border need no other tile.
+ */
+struct MapTile {
+  int tx = 0;
+  int ty = 0;
+  int x0 = 0; // First map cell of the tile
+  int y0 = 0;
+  OccupancyGrid cells;
+};
+
+namespace detail {
+
+constexpr uint32_t kTileFileMagic = 0x4c544d47; // "GMTL"
+constexpr uint32_t kTileFileFormat = 1;
+constexpr size_t kTileFileAlignment = 64;
+
+struct TileFileHeader {
+  uint32_t magic;
+  uint32_t format;
+  int32_t width;
+  int32_t height;
+  int32_t tileSize;
+  float resolution;
+  float originX;
+  float originY;
+  float originYaw;
+  uint32_t reserved;
+  uint64_t mapHash;
+};
+
+inline size_t tileAligned(size_t size) {
+  return (size + kTileFileAlignment - 1) / kTileFileAlignment * kTileFileAlignment;
+}
+
+/// Every tile gets a slot of the same size: cells, then the passability words with their apron.
+inline size_t tileCellBytes(int tileSize) {
+  return tileAligned(static_cast<size_t>(tileSize) * static_cast<size_t>(tileSize));
+}
+
+inline size_t tileSlotBytes(int tileSize) {
+  return tileCellBytes(tileSize) + tileAligned(OccupancyGrid::passableWordCount(tileSize, tileSize) * sizeof(uint64_t));
+}
+
+} // namespace detail
+
+/** Writes `grid` as a tiled map file, one fixed-size slot per tile.
+ *
+ * Tiles are stored row by row. Each slot holds the tile's cells and its
+ * packed passability with a one-cell apron taken from the neighbors, so a
+ * tile is read back with a single read. Returns false on I/O errors.
+ */
+inline bool saveTiledMap(const std::string &path, const OccupancyGrid &grid, const MapInfo &info, int tileSize = 256) {
+  if (tileSize <= 0) return false;
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) return false;
+
+  const detail::TileFileHeader header{detail::kTileFileMagic, detail::kTileFileFormat, grid.width(), grid.height(),
+                                      tileSize, info.resolution, info.originX, info.originY, info.originYaw, 0,
+                                      passabilityHash(grid)};
+  std::vector<char> slot(detail::tileAligned(sizeof(header)), 0);
+  std::memcpy(slot.data(), &header, sizeof(header));
+  file.write(slot.data(), static_cast<std::streamsize>(slot.size()));
+
+  const int tilesX = (grid.width() + tileSize - 1) / tileSize;
+  const int tilesY = (grid.height() + tileSize - 1) / tileSize;
+  for (int ty = 0; ty < tilesY; ++ty) {
+    for (int tx = 0; tx < tilesX; ++tx) {
+      const int x0 = tx * tileSize;
+      const int y0 = ty * tileSize;
+      const int w = std::min(tileSize, grid.width() - x0);
+      const int h = std::min(tileSize, grid.height() - y0);
+      slot.assign(detail::tileSlotBytes(tileSize), 0);
+      for (int y = 0; y < h; ++y) {
+        std::memcpy(slot.data() + static_cast<size_t>(y) * w, grid.data() + grid.index(x0, y0 + y), static_cast<size_t>(w));
+      }
+      // Passability rows -1..h, cells -1..w, with local cell x at bit x + 1 as in OccupancyGrid
+      uint64_t *bits = reinterpret_cast<uint64_t *>(slot.data() + detail::tileCellBytes(tileSize));
+      const size_t rowWords = OccupancyGrid::rowWordCount(w);
+      for (int y = -1; y <= h; ++y) {
+        for (int x = -1; x <= w; ++x) {
+          if (!grid.isPassable(x0 + x, y0 + y)) continue;
+          const size_t bit = static_cast<size_t>(x + 1);
+          bits[static_cast<size_t>(y + 1) * rowWords + (bit >> 6)] |= uint64_t{1} << (bit & 63);
+        }
+      }
+      file.write(slot.data(), static_cast<std::streamsize>(slot.size()));
+    }
+  }
+  return static_cast<bool>(file);
+}
+
+/** Tiles of a map file, read from disk on demand and kept in an LRU cache.
+ *
+ * At most `budgetBytes` of tiles stay resident (but always at least a few),
+ * and the least recently requested tile is dropped first. Tiles are handed
+ * out as shared pointers, so a dropped tile stays valid for whoever still
+ * holds it. tile() is thread-safe. The store is read-only.
+ */
+class TileStore {
+public:
+  static constexpr size_t kMinResidentTiles = 9; // A tile and its eight neighbors
+
+  TileStore() = default;
+  TileStore(const TileStore &) = delete;
+  TileStore &operator=(const TileStore &) = delete;
+
+  ~TileStore() { close(); }
+
+  /// Opens a file written by saveTiledMap(); false if missing or of another format.
+  bool open(const std::string &path, size_t budgetBytes_) {
+    close();
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    detail::TileFileHeader header{};
+    if (::pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+        header.magic != detail::kTileFileMagic || header.format != detail::kTileFileFormat || header.width <= 0 ||
+        header.height <= 0 || header.tileSize <= 0) {
+      close();
+      return false;
+    }
+    mapWidth = header.width;
+    mapHeight = header.height;
+    size = header.tileSize;
+    countX = (mapWidth + size - 1) / size;
+    countY = (mapHeight + size - 1) / size;
+    slotBytes = detail::tileSlotBytes(size);
+    dataOffset = detail::tileAligned(sizeof(header));
+    hash = header.mapHash;
+    mapInfo = MapInfo();
+    mapInfo.image = path;
+    mapInfo.resolution = header.resolution;
+    mapInfo.originX = header.originX;
+    mapInfo.originY = header.originY;
+    mapInfo.originYaw = header.originYaw;
+    setBudget(budgetBytes_);
+    return true;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    lru.clear();
+    resident.clear();
+  }
+
+  void setBudget(size_t budgetBytes_) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budgetBytes = budgetBytes_;
+    trim();
+  }
+
+  int width() const { return mapWidth; }
+  int height() const { return mapHeight; }
+  int tileSize() const { return size; }
+  int tilesX() const { return countX; }
+  int tilesY() const { return countY; }
+  uint64_t mapHash() const { return hash; }
+  const MapInfo &info() const { return mapInfo; }
+  MapMetaData metaData() const { return mapInfo.metaData(mapWidth, mapHeight); }
+
+  /// Tile (tx, ty), loaded if not resident; null if out of range. A tile that cannot be read comes back blocked.
+  std::shared_ptr<const MapTile> tile(int tx, int ty) {
+    if (tx < 0 || ty < 0 || tx >= countX || ty >= countY) return nullptr;
+    const int64_t key = static_cast<int64_t>(ty) * countX + tx;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = resident.find(key);
+    if (found != resident.end()) {
+      ++hitCount;
+      lru.splice(lru.begin(), lru, found->second.position);
+      return found->second.tile;
+    }
+
+    std::shared_ptr<const MapTile> loaded = load(tx, ty);
+    if (!loaded) {
+      ++failureCount;
+      return blockedTile(tx, ty); // Not cached, the next request retries
+    }
+    ++loadCount;
+    lru.push_front(key);
+    resident[key] = Entry{loaded, lru.begin()};
+    trim();
+    return loaded;
+  }
+
+  size_t residentTiles() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return resident.size();
+  }
+
+  size_t residentBytes() const { return residentTiles() * slotBytes; }
+  size_t budget() const { return budgetBytes; }
+  uint64_t loads() const { return loadCount; }
+  uint64_t hits() const { return hitCount; }
+  uint64_t failures() const { return failureCount; }
+
+private:
+  struct Entry {
+    std::shared_ptr<const MapTile> tile;
+    std::list<int64_t>::iterator position;
+  };
+
+  int fd = -1;
+  int mapWidth = 0;
+  int mapHeight = 0;
+  int size = 0;
+  int countX = 0;
+  int countY = 0;
+  size_t slotBytes = 0;
+  size_t dataOffset = 0;
+  uint64_t hash = 0;
+  MapInfo mapInfo;
+  size_t budgetBytes = 0;
+  mutable std::mutex mutex;
+  std::list<int64_t> lru; // Most recently used first
+  std::unordered_map<int64_t, Entry> resident;
+  std::atomic<uint64_t> loadCount{0};
+  std::atomic<uint64_t> hitCount{0};
+  std::atomic<uint64_t> failureCount{0};
+
+  std::shared_ptr<const MapTile> blockedTile(int tx, int ty) const {
+    auto result = std::make_shared<MapTile>();
+    result->tx = tx;
+    result->ty = ty;
+    result->x0 = tx * size;
+    result->y0 = ty * size;
+    result->cells = OccupancyGrid(std::min(size, mapWidth - result->x0), std::min(size, mapHeight - result->y0),
+                                  OccupancyGrid::kUnknown);
+    return result;
+  }
+
+  std::shared_ptr<const MapTile> load(int tx, int ty) const {
+    auto buffer = std::shared_ptr<char>(new char[slotBytes], std::default_delete<char[]>());
+    const off_t offset = static_cast<off_t>(dataOffset + (static_cast<size_t>(ty) * countX + tx) * slotBytes);
+    if (::pread(fd, buffer.get(), slotBytes, offset) != static_cast<ssize_t>(slotBytes)) return nullptr;
+
+    auto result = std::make_shared<MapTile>();
+    result->tx = tx;
+    result->ty = ty;
+    result->x0 = tx * size;
+    result->y0 = ty * size;
+    const int w = std::min(size, mapWidth - result->x0);
+    const int h = std::min(size, mapHeight - result->y0);
+    char *data = buffer.get();
+    result->cells = OccupancyGrid(w, h, reinterpret_cast<int8_t *>(data),
+                                  reinterpret_cast<uint64_t *>(data + detail::tileCellBytes(size)), std::move(buffer));
+    return result;
+  }
+
+  void trim() {
+    const size_t limit = std::max(kMinResidentTiles, slotBytes == 0 ? kMinResidentTiles : budgetBytes / slotBytes);
+    while (resident.size() > limit) {
+      resident.erase(lru.back());
+      lru.pop_back();
+    }
+  }
+};
+
+/** Read-only grid view over a TileStore with the interface the planners use.
+ *
+ * The view remembers the tile of its last lookup, so runs of lookups inside
+ * one tile skip the store and its lock; crossing into another tile costs
+ * one store lookup. Cells outside the map read as blocked, like
+ * OccupancyGrid. A view is cheap but not thread-safe: give each thread its
+ * own view of the shared store.
+ */
+class TiledGridView {
+public:
+  explicit TiledGridView(TileStore &store_) : store(&store_) {}
+
+  TiledGridView(const TiledGridView &o) : store(o.store) {}
+  TiledGridView &operator=(const TiledGridView &o) {
+    store = o.store;
+    current.reset();
+    return *this;
+  }
+
+  int width() const { return store->width(); }
+  int height() const { return store->height(); }
+  size_t cellCount() const { return static_cast<size_t>(width()) * static_cast<size_t>(height()); }
+  CellRect bounds() const { return {0, 0, width(), height()}; }
+
+  bool inBounds(int x, int y) const { return x >= 0 && x < width() && y >= 0 && y < height(); }
+
+  size_t index(int x, int y) const {
+    return static_cast<size_t>(y) * static_cast<size_t>(width()) + static_cast<size_t>(x);
+  }
+
+  /// Never changes; the store is read-only.
+  uint64_t version() const { return 1; }
+
+  int8_t value(int x, int y) const {
+    if (!inBounds(x, y)) return OccupancyGrid::kUnknown;
+    const MapTile &t = tileAt(x, y);
+    return t.cells.value(x - t.x0, y - t.y0);
+  }
+
+  bool isPassable(int x, int y) const {
+    if (!inBounds(x, y)) return false;
+    const MapTile &t = tileAt(x, y);
+    return t.cells.isPassable(x - t.x0, y - t.y0);
+  }
+
+  /// Same layout as OccupancyGrid::passableNeighborhood(); the tile apron covers the border.
+  unsigned passableNeighborhood(int x, int y) const {
+    const MapTile &t = tileAt(x, y);
+    return t.cells.passableNeighborhood(x - t.x0, y - t.y0);
+  }
+
+  TileStore &tileStore() const { return *store; }
+
+private:
+  TileStore *store;
+  mutable std::shared_ptr<const MapTile> current;
+
+  /// (x, y) must be inside the map.
+  const MapTile &tileAt(int x, int y) const {
+    if (!current || x < current->x0 || y < current->y0 || x >= current->x0 + current->cells.width() ||
+        y >= current->y0 + current->cells.height()) {
+      const int size = store->tileSize();
+      current = store->tile(x / size, y / size);
+    }
+    return *current;
+  }
+};
+
+} // namespace gridmap
+
+#endif // TILE_STORE_HPP_
@@ -0,0 +1,66 @@
+#ifndef TIMING_HISTORY_HPP_
+#define TIMING_HISTORY_HPP_
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+namespace gridmap {
+
+/** The last kSamples durations of some recurring work, in milliseconds.
+ *
+ * A fixed ring buffer, laid out the way ImGui::PlotHistogram() and
+ * PlotLines() take their values: samples() with size() values, the oldest
+ * at offset().
+ */
+class TimingHistory {
+public:
+  static constexpr size_t kSamples = 120;
+
+  void add(float milliseconds) {
+    values[next] = milliseconds;
+    next = (next + 1) % kSamples;
+    count = std::min(count + 1, kSamples);
+  }
+
+  const float *samples() const { return values.data(); }
+  int size() const { return static_cast<int>(count); }
+  int offset() const { return count < kSamples ? 0 : static_cast<int>(next); }
+
+  float last() const { return count == 0 ? 0.0f : values[(next + kSamples - 1) % kSamples]; }
+
+  float mean() const {
+    float sum = 0.0f;
+    for (size_t i = 0; i < count; ++i) sum += values[i];
+    return count == 0 ? 0.0f : sum / static_cast<float>(count);
+  }
+
+  float max() const { return count == 0 ? 0.0f : *std::max_element(values.begin(), values.begin() + count); }
+
+private:
+  std::array<float, kSamples> values{};
+  size_t next = 0;
+  size_t count = 0;
+};
+
+/// Adds the time between construction and destruction to a TimingHistory.
+class ScopedTiming {
+public:
+  explicit ScopedTiming(TimingHistory &history_) : history(history_), begin(std::chrono::steady_clock::now()) {}
+
+  ~ScopedTiming() {
+    history.add(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - begin).count());
+  }
+
+  ScopedTiming(const ScopedTiming &) = delete;
+  ScopedTiming &operator=(const ScopedTiming &) = delete;
+
+private:
+  TimingHistory &history;
+  std::chrono::steady_clock::time_point begin;
+};
+
+} // namespace gridmap
+
+#endif // TIMING_HISTORY_HPP_
@@ -0,0 +1,46 @@
+#ifndef TRIPLE_BUFFER_HPP_
+#define TRIPLE_BUFFER_HPP_
+
+#include <atomic>
+#include <cstdint>
+
+/** Single-producer, single-consumer hand-off of the latest value.
+ *
+ * The writer fills a private back buffer and swaps it with the shared middle
+ * slot; the reader swaps the middle slot with its private front buffer when a
+ * new value is flagged. Neither side ever blocks, and the reader always sees
+ * the most recently published value.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+  /// Writer side: buffer to fill before calling publish().
+  T &back() { return buffers[backIndex]; }
+
+  void publish() {
+    const uint8_t previous = middle.exchange(static_cast<uint8_t>(backIndex | kDirty),
+                                             std::memory_order_acq_rel);
+    backIndex = previous & kIndexMask;
+  }
+
+  /// Reader side: adopts the newest published value; returns false if nothing new arrived.
+  bool update() {
+    if ((middle.load(std::memory_order_relaxed) & kDirty) == 0) return false;
+    const uint8_t previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+    frontIndex = previous & kIndexMask;
+    return true;
+  }
+
+  const T &front() const { return buffers[frontIndex]; }
+
+private:
+  static constexpr uint8_t kIndexMask = 0x3;
+  static constexpr uint8_t kDirty = 0x4;
+
+  T buffers[3];
+  uint8_t frontIndex = 0;
+  std::atomic<uint8_t> middle{1};
+  uint8_t backIndex = 2;
+};
+
+#endif // TRIPLE_BUFFER_HPP_
@@ -0,0 +1,471 @@
+/** Headless planner benchmark.
+ *
+ * Loads every maze-*.png in the data directory, draws seeded random
+ * start/goal pairs that are known to be connected and runs each planner on
+ * them, one query at a time and as a parallel batch. A* is also run with
+ * each open list from open_list.hpp, reporting how far the bucket queue's
+ * path costs stray from the exact ones. The A* paths are then smoothed to
+ * time the post-processing that runs after every replan. Sending every
+ * start to one goal compares a single flow field plus a descent per start
+ * with an A* search per start, and the connected-component labeling that
+ * lets the planner reject unreachable goals is timed. The SE(2) lattice
+ * plans the first queries between poses that face along the start-goal
+ * line, with its flow field heuristic timed apart. A replanning run then
+ * blocks cells ahead of a moving start and compares D* Lite repairs with
+ * A* from scratch. A tiled run repeats the A* queries on the map streamed
+ * from a tile file under a memory budget of a quarter of the map. Results
+ * go to stdout as JSON, progress to stderr.
+ *
+ * Usage: bench_planner [data_dir] [queries_per_map] [seed] [landmark_cache_dir]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "a_star.hpp"
+#include "batch_planner.hpp"
+#include "connected_components.hpp"
+#include "d_star_lite.hpp"
+#include "flow_field.hpp"
+#include "grid_planner.hpp"
+#include "lattice_planner.hpp"
+#include "map_loader.hpp"
+#include "occupancy_grid.hpp"
+#include "open_list.hpp"
+#include "path_smoothing.hpp"
+#include "search_stats.hpp"
+#include "search_workspace.hpp"
+#include "tile_store.hpp"
+
+namespace {
+
+constexpr int kReplanSteps = 50;
+constexpr int kBlockedPerStep = 3;
+constexpr int kBenchTileSize = 64;
+constexpr size_t kLatticeQueries = 50;
+
+using TiledAStar = astar::BasicAStar<astar::OctileHeuristic, astar::UniformCost, gridmap::TiledGridView>;
+
+constexpr astar::Algorithm kAlgorithms[] = {
+  astar::Algorithm::kAStar,
+  astar::Algorithm::kJumpPoint,
+  astar::Algorithm::kJumpPointBitScan,
+  astar::Algorithm::kHierarchical,
+  astar::Algorithm::kLandmarks,
+  astar::Algorithm::kCostAware,
+};
+
+long peakRssKb() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss; // Kilobytes on Linux
+}
+
+/// Labels 8-connected free regions (diagonals need only the target cell free, like the planners).
+std::vector<int> labelComponents(const gridmap::OccupancyGrid &grid) {
+  std::vector<int> labels(grid.cellCount(), -1);
+  std::vector<int> stack;
+  int next = 0;
+  for (int y = 0; y < grid.height(); ++y) {
+    for (int x = 0; x < grid.width(); ++x) {
+      const size_t seed = grid.index(x, y);
+      if (labels[seed] >= 0 || !grid.isPassable(x, y)) continue;
+      labels[seed] = next;
+      stack.push_back(static_cast<int>(seed));
+      while (!stack.empty()) {
+        const int cell = stack.back();
+        stack.pop_back();
+        const int cx = cell % grid.width();
+        const int cy = cell / grid.width();
+        for (int dy = -1; dy <= 1; ++dy) {
+          for (int dx = -1; dx <= 1; ++dx) {
+            const int nx = cx + dx;
+            const int ny = cy + dy;
+            if (!grid.isPassable(nx, ny)) continue;
+            const size_t n = grid.index(nx, ny);
+            if (labels[n] >= 0) continue;
+            labels[n] = next;
+            stack.push_back(static_cast<int>(n));
+          }
+        }
+      }
+      ++next;
+    }
+  }
+  return labels;
+}
+
+std::vector<astar::PathQuery> makeQueries(const gridmap::OccupancyGrid &grid, int count, uint32_t seed) {
+  const std::vector<int> labels = labelComponents(grid);
+  std::vector<int> freeCells;
+  for (size_t i = 0; i < labels.size(); ++i) {
+    if (labels[i] >= 0) freeCells.push_back(static_cast<int>(i));
+  }
+  std::vector<astar::PathQuery> queries;
+  if (freeCells.size() < 2) return queries;
+
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<size_t> pick(0, freeCells.size() - 1);
+  const int maxAttempts = count * 1000;
+  for (int attempt = 0; attempt < maxAttempts && static_cast<int>(queries.size()) < count; ++attempt) {
+    const int a = freeCells[pick(gen)];
+    const int b = freeCells[pick(gen)];
+    if (a == b || labels[a] != labels[b]) continue;
+    queries.push_back({astar::Point(a % grid.width(), a / grid.width()),
+                       astar::Point(b % grid.width(), b / grid.width())});
+  }
+  return queries;
+}
+
+double percentile(std::vector<double> sorted, double p) {
+  if (sorted.empty()) return 0.0;
+  std::sort(sorted.begin(), sorted.end());
+  const size_t rank = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+  return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+std::string jsonString(const std::string &s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out + "\"";
+}
+
+double pathCost(const std::vector<astar::Point> &path) {
+  double cost = 0.0;
+  for (size_t i = 1; i < path.size(); ++i) {
+    const bool diagonal = path[i].x != path[i - 1].x && path[i].y != path[i - 1].y;
+    cost += diagonal ? std::sqrt(2.0f) : 1.0f;
+  }
+  return cost;
+}
+
+/// Runs all queries with one open list; the first run fills `referenceCosts`, later runs are compared to it.
+template <typename OpenList>
+void benchOpenList(const char *name, const gridmap::OccupancyGrid &grid, const std::vector<astar::PathQuery> &queries,
+                   astar::SearchWorkspace &workspace, std::vector<double> &referenceCosts, bool first) {
+  const astar::BasicAStar<astar::OctileHeuristic, astar::UniformCost, gridmap::OccupancyGrid, OpenList> planner(
+    grid, astar::Point(), astar::Point());
+  const bool reference = referenceCosts.empty();
+  std::vector<astar::Point> path;
+  astar::SearchStatsHooks hooks;
+  uint64_t expanded = 0;
+  size_t openPeak = 0;
+  double seconds = 0.0;
+  double maxExcess = 0.0;
+  for (size_t i = 0; i < queries.size(); ++i) {
+    const auto begin = std::chrono::steady_clock::now();
+    planner.findPath(queries[i].start, queries[i].goal, workspace, path, hooks);
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    expanded += hooks.stats.expanded;
+    openPeak = std::max(openPeak, hooks.stats.openPeak);
+    const double cost = pathCost(path);
+    if (reference) {
+      referenceCosts.push_back(cost);
+    } else {
+      maxExcess = std::max(maxExcess, cost - referenceCosts[i]);
+    }
+  }
+  std::cout << (first ? "\n" : ",\n") << "        {\"open_list\": " << jsonString(name)
+            << ", \"queries_per_sec\": " << (seconds > 0.0 ? static_cast<double>(queries.size()) / seconds : 0.0)
+            << ", \"nodes_expanded\": " << expanded << ", \"open_peak\": " << openPeak
+            << ", \"max_cost_excess\": " << maxExcess << "}";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::filesystem::path dataDir = argc > 1 ? argv[1] : "../data";
+  const int queriesPerMap = argc > 2 ? std::max(1, std::atoi(argv[2])) : 200;
+  const uint32_t seed = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 42u;
+  const std::filesystem::path landmarkCacheDir = argc > 4 ? argv[4] : "";
+
+  std::vector<std::filesystem::path> maps;
+  std::error_code error;
+  for (const auto &entry : std::filesystem::directory_iterator(dataDir, error)) {
+    const std::string name = entry.path().filename().string();
+    if (name.rfind("maze-", 0) == 0 && entry.path().extension() == ".png") maps.push_back(entry.path());
+  }
+  if (error) {
+    std::cerr << "Cannot read " << dataDir << ": " << error.message() << "\n";
+    return 1;
+  }
+  std::sort(maps.begin(), maps.end());
+
+  std::cout << "{\n  \"seed\": " << seed << ",\n  \"queries_per_map\": " << queriesPerMap
+            << ",\n  \"maps\": [";
+  bool firstMap = true;
+  for (const auto &mapPath : maps) {
+    gridmap::OccupancyGrid grid;
+    if (!gridmap::loadImageMap(mapPath.string(), grid)) {
+      std::cerr << "Skipping " << mapPath << ": " << stbi_failure_reason() << "\n";
+      continue;
+    }
+    const std::vector<astar::PathQuery> queries = makeQueries(grid, queriesPerMap, seed);
+    std::cerr << mapPath.filename().string() << ": " << grid.width() << "x" << grid.height() << ", "
+              << queries.size() << " queries\n";
+
+    std::cout << (firstMap ? "\n" : ",\n") << "    {\n      \"map\": " << jsonString(mapPath.filename().string())
+              << ",\n      \"width\": " << grid.width() << ",\n      \"height\": " << grid.height()
+              << ",\n      \"queries\": " << queries.size() << ",\n      \"algorithms\": [";
+    firstMap = false;
+
+    const std::string landmarkCache = landmarkCacheDir.empty() ? std::string() :
+      (landmarkCacheDir / (mapPath.filename().string() + ".landmarks")).string();
+    astar::GridPlanner planner(grid, landmarkCache);
+    astar::SearchWorkspace workspace;
+    std::vector<astar::Point> path;
+    bool firstAlgorithm = true;
+    for (astar::Algorithm algorithm : kAlgorithms) {
+      // Preprocessing (HPA* abstract graph, ALT landmark tables, costmap) is timed apart from the queries
+      const auto prepareBegin = std::chrono::steady_clock::now();
+      planner.prepare(algorithm);
+      const double prepareMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - prepareBegin).count();
+
+      const bool countsExpansions = algorithm != astar::Algorithm::kHierarchical;
+      std::vector<double> latencies;
+      latencies.reserve(queries.size());
+      uint64_t expanded = 0;
+      size_t failures = 0;
+      const auto begin = std::chrono::steady_clock::now();
+      for (const astar::PathQuery &query : queries) {
+        const auto queryBegin = std::chrono::steady_clock::now();
+        const bool found = planner.findPath(algorithm, query.start, query.goal, workspace, path);
+        latencies.push_back(std::chrono::duration<double, std::micro>(
+          std::chrono::steady_clock::now() - queryBegin).count());
+        if (!found) ++failures;
+        if (countsExpansions) expanded += workspace.expanded();
+      }
+      const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+      std::cout << (firstAlgorithm ? "\n" : ",\n") << "        {\"algorithm\": "
+                << jsonString(astar::algorithmName(algorithm))
+                << ", \"preprocess_ms\": " << prepareMs
+                << ", \"queries_per_sec\": " << (seconds > 0.0 ? static_cast<double>(queries.size()) / seconds : 0.0)
+                << ", \"nodes_expanded\": ";
+      if (countsExpansions) {
+        std::cout << expanded;
+      } else {
+        std::cout << "null";
+      }
+      std::cout << ", \"p50_us\": " << percentile(latencies, 0.50)
+                << ", \"p99_us\": " << percentile(latencies, 0.99)
+                << ", \"failures\": " << failures
+                << ", \"peak_rss_kb\": " << peakRssKb() << "}";
+      firstAlgorithm = false;
+    }
+    std::cout << "\n      ]";
+
+    // Same A* queries per open list; the indexed heap is the exact reference
+    std::cout << ",\n      \"open_lists\": [";
+    std::vector<double> referenceCosts;
+    benchOpenList<astar::IndexedHeapOpenList<4>>("indexed 4-ary heap", grid, queries, workspace, referenceCosts, true);
+    benchOpenList<astar::IndexedHeapOpenList<2>>("indexed binary heap", grid, queries, workspace, referenceCosts, false);
+    benchOpenList<astar::LazyHeapOpenList>("lazy binary heap", grid, queries, workspace, referenceCosts, false);
+    benchOpenList<astar::BucketOpenList<16>>("bucket queue", grid, queries, workspace, referenceCosts, false);
+    std::cout << "\n      ]";
+
+    // Shortcutting and splining every A* path, as the viewer does after each replan
+    {
+      astar::AStar planner(grid, astar::Point(), astar::Point());
+      astar::PathSmoother smoother(grid);
+      std::vector<astar::PathPose> poses;
+      size_t cells = 0;
+      size_t waypoints = 0;
+      size_t poseCount = 0;
+      double seconds = 0.0;
+      for (const astar::PathQuery &query : queries) {
+        planner.findPath(query.start, query.goal, workspace, path);
+        const auto begin = std::chrono::steady_clock::now();
+        smoother.smooth(path, 0.0f, astar::PathSmoother::kFreeHeading, poses);
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        cells += path.size();
+        waypoints += smoother.shortcutWaypoints().size();
+        poseCount += poses.size();
+      }
+      std::cout << ",\n      \"smoothing\": {\"mean_us\": "
+                << (queries.empty() ? 0.0 : seconds * 1e6 / static_cast<double>(queries.size()))
+                << ", \"path_cells\": " << cells << ", \"waypoints\": " << waypoints << ", \"poses\": " << poseCount << "}";
+    }
+
+    // Every query start heading for the first query's goal: one flow field and a descent per agent vs. A* per agent
+    if (!queries.empty()) {
+      const astar::Point goal = queries.front().goal;
+      astar::AStar planner(grid, astar::Point(), astar::Point());
+      astar::ThreadPool &pool = astar::ThreadPool::shared();
+      astar::FlowField field;
+      std::vector<astar::Point> descent;
+      const auto fieldBegin = std::chrono::steady_clock::now();
+      field.compute(grid, goal, pool);
+      const double fieldMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - fieldBegin).count();
+      double extractSeconds = 0.0;
+      double searchSeconds = 0.0;
+      size_t mismatches = 0;
+      for (const astar::PathQuery &query : queries) {
+        const auto begin = std::chrono::steady_clock::now();
+        const bool fromField = field.findPath(query.start, descent);
+        const auto middle = std::chrono::steady_clock::now();
+        const bool fromSearch = planner.findPath(query.start, goal, workspace, path);
+        extractSeconds += std::chrono::duration<double>(middle - begin).count();
+        searchSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - middle).count();
+        if (fromField != fromSearch || std::fabs(pathCost(descent) - pathCost(path)) > 1e-3 * pathCost(path)) ++mismatches;
+      }
+      const double agents = static_cast<double>(queries.size());
+      std::cout << ",\n      \"flow_field\": {\"agents\": " << queries.size() << ", \"threads\": " << pool.size()
+                << ", \"field_ms\": " << fieldMs << ", \"reached_cells\": " << field.reachedCells()
+                << ", \"extract_mean_us\": " << extractSeconds * 1e6 / agents
+                << ", \"astar_mean_us\": " << searchSeconds * 1e6 / agents
+                << ", \"cost_mismatches\": " << mismatches << "}";
+    }
+
+    // Relabeling the reachability index that GridPlanner checks every query against
+    {
+      astar::ConnectedComponents components(grid);
+      const auto begin = std::chrono::steady_clock::now();
+      components.rebuild();
+      std::cout << ",\n      \"components\": {\"count\": " << components.componentCount() << ", \"rebuild_ms\": "
+                << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() << "}";
+    }
+
+    // Pose-to-pose lattice queries, headings along the start-goal line; the flow field heuristic is timed apart
+    if (!queries.empty()) {
+      astar::GridPlanner planner(grid);
+      const auto tableBegin = std::chrono::steady_clock::now();
+      const astar::LatticePlanner &lattice = planner.latticePlanner();
+      const double tableMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tableBegin).count();
+      const size_t count = std::min(queries.size(), kLatticeQueries);
+      astar::NoSearchHooks hooks;
+      std::vector<astar::PathPose> poses;
+      std::vector<double> latencies;
+      double fieldMs = 0.0;
+      uint64_t expanded = 0;
+      size_t failures = 0;
+      for (size_t i = 0; i < count; ++i) {
+        const astar::PathQuery &query = queries[i];
+        const float heading = std::atan2(static_cast<float>(query.goal.y - query.start.y),
+                                         static_cast<float>(query.goal.x - query.start.x));
+        const auto fieldBegin = std::chrono::steady_clock::now();
+        planner.flowFields().field(query.goal);
+        const auto searchBegin = std::chrono::steady_clock::now();
+        const bool found = planner.findPath(astar::Algorithm::kLattice, query.start, heading, query.goal, heading,
+                                            workspace, path, poses, hooks);
+        const auto end = std::chrono::steady_clock::now();
+        fieldMs += std::chrono::duration<double, std::milli>(searchBegin - fieldBegin).count();
+        latencies.push_back(std::chrono::duration<double, std::milli>(end - searchBegin).count());
+        expanded += workspace.expanded();
+        if (!found) ++failures;
+      }
+      std::cout << ",\n      \"lattice\": {\"queries\": " << count
+                << ", \"primitives\": " << lattice.primitiveTable().primitiveCount() << ", \"table_ms\": " << tableMs
+                << ", \"field_mean_ms\": " << fieldMs / static_cast<double>(count)
+                << ", \"p50_ms\": " << percentile(latencies, 0.50) << ", \"p99_ms\": " << percentile(latencies, 0.99)
+                << ", \"states_expanded\": " << expanded << ", \"failures\": " << failures << "}";
+    }
+
+    // Batch throughput on one worker and on all cores shows how well queries scale
+    std::cout << ",\n      \"batch\": [";
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    bool firstBatch = true;
+    for (unsigned threads : {1u, cores}) {
+      if (!firstBatch && threads == 1u) break;
+      astar::BatchPlanner batch(grid, threads);
+      const auto begin = std::chrono::steady_clock::now();
+      const std::vector<astar::PathResult> results = batch.findPaths(queries);
+      const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+      std::cout << (firstBatch ? "\n" : ",\n") << "        {\"algorithm\": "
+                << jsonString(astar::algorithmName(astar::Algorithm::kAStar)) << ", \"threads\": " << threads
+                << ", \"queries_per_sec\": " << (seconds > 0.0 ? static_cast<double>(results.size()) / seconds : 0.0)
+                << "}";
+      firstBatch = false;
+    }
+    std::cout << "\n      ]";
+
+    // Robot follows the path while cells ahead of it get blocked: D* Lite repair vs. A* from scratch
+    if (!queries.empty()) {
+      gridmap::OccupancyGrid dynamicGrid = grid;
+      astar::DStarLite incremental(dynamicGrid);
+      astar::AStar full(dynamicGrid, astar::Point(), astar::Point());
+      std::mt19937 gen(seed);
+      astar::Point start = queries.front().start;
+      const astar::Point goal = queries.front().goal;
+      double incrementalMs = 0.0;
+      double fullMs = 0.0;
+      uint64_t incrementalExpanded = 0;
+      uint64_t fullExpanded = 0;
+      int steps = 0;
+      for (; steps < kReplanSteps; ++steps) {
+        auto begin = std::chrono::steady_clock::now();
+        const bool found = incremental.findPath(start, goal, path);
+        incrementalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        incrementalExpanded += incremental.expanded();
+
+        std::vector<astar::Point> fullPath;
+        begin = std::chrono::steady_clock::now();
+        full.findPath(start, goal, workspace, fullPath);
+        fullMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        fullExpanded += workspace.expanded();
+        if (!found || path.size() < 4) break;
+
+        const size_t advance = std::min<size_t>(5, path.size() - 3);
+        start = path[advance];
+        std::uniform_int_distribution<size_t> ahead(advance + 1, std::min(path.size() - 2, advance + 30));
+        for (int k = 0; k < kBlockedPerStep; ++k) {
+          const astar::Point cell = path[ahead(gen)];
+          dynamicGrid.setValue(cell.x, cell.y, gridmap::OccupancyGrid::kOccupied);
+        }
+      }
+      std::cout << ",\n      \"replanning\": {\"steps\": " << steps
+                << ", \"incremental_ms\": " << incrementalMs << ", \"incremental_expanded\": " << incrementalExpanded
+                << ", \"full_ms\": " << fullMs << ", \"full_expanded\": " << fullExpanded << "}";
+    }
+
+    // A* on the map streamed from disk; tile switches and LRU misses are the overhead over the in-memory grid
+    const std::filesystem::path tilePath =
+      std::filesystem::temp_directory_path() / (mapPath.filename().string() + ".gtiles");
+    gridmap::TileStore store;
+    if (!queries.empty() && gridmap::saveTiledMap(tilePath.string(), grid, gridmap::MapInfo(), kBenchTileSize) &&
+        store.open(tilePath.string(), 0)) {
+      const size_t totalBytes = static_cast<size_t>(store.tilesX()) * store.tilesY() *
+                                (gridmap::detail::tileSlotBytes(kBenchTileSize));
+      store.setBudget(totalBytes / 4);
+      const gridmap::TiledGridView view(store);
+      const TiledAStar tiled(view, astar::Point(), astar::Point());
+      astar::AStar inMemory(grid, astar::Point(), astar::Point());
+      std::vector<astar::Point> reference;
+      size_t mismatches = 0;
+      double seconds = 0.0;
+      for (const astar::PathQuery &query : queries) {
+        const auto begin = std::chrono::steady_clock::now();
+        tiled.findPath(query.start, query.goal, workspace, path);
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        inMemory.findPath(query.start, query.goal, workspace, reference);
+        if (path.size() != reference.size()) ++mismatches;
+      }
+      std::cout << ",\n      \"tiled\": {\"tile_size\": " << kBenchTileSize << ", \"budget_kb\": " << store.budget() / 1024
+                << ", \"queries_per_sec\": " << (seconds > 0.0 ? static_cast<double>(queries.size()) / seconds : 0.0)
+                << ", \"tile_loads\": " << store.loads() << ", \"tile_hits\": " << store.hits()
+                << ", \"resident_kb\": " << store.residentBytes() / 1024 << ", \"mismatches\": " << mismatches << "}";
+      store.close();
+      std::filesystem::remove(tilePath, error);
+    }
+    std::cout << "\n    }";
+  }
+  std::cout << "\n  ]\n}\n";
+  return 0;
+}
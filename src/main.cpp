@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
 #include <memory>
 #include <random>
@@ -10,6 +12,21 @@
 #include "render_module/render_module.hpp" 
 #include "render_module/glad_wrapper.hpp"
 #include "a_star.hpp"
+#include "async_planner.hpp"
+#include "costmap.hpp"
+#include "flow_field.hpp"
+#include "map_file.hpp"
+#include "map_info.hpp"
+#include "map_editor.hpp"
+#include "map_loader.hpp"
+#include "occupancy_grid.hpp"
+#include "path_smoothing.hpp"
+#include "planning_service.hpp"
+#include "query_trace.hpp"
+#include "search_stats.hpp"
+#include "square_overlay.hpp"
+#include "tile_renderer.hpp"
+#include "timing_history.hpp"
 
 
 enum class PoseInteractionState {
@@ -99,58 +116,52 @@ bool HandlePoseInteractionStateMachine(Pose& pose,
 
 
 
-int main() {
+int main(int argc, char** argv) {
 
-    // constexpr auto img_path = "../data/maze-1-10x10.png";
-    constexpr auto img_path = "../data/maze-1-100x100.png";
-    // constexpr auto img_path = "../data/maze-4-500x500.png";
-    int width, height, channels;
-
-    std::cout << "Loading image: " << img_path << "\n";
-
-    // Custom deleter using stbi_image_free
-    auto stbi_deleter = [](unsigned char* p) { stbi_image_free(p); };
-    int required_channels = 1;
-
-    std::unique_ptr<unsigned char, decltype(stbi_deleter)>
-        data(stbi_load(img_path, &width, &height, &channels, required_channels), stbi_deleter);
-    channels = required_channels;
-    
-    if (!data) {
-        std::cerr << "Failed to load image\n";
-        return 1;
-    }
-
-    std::cout << "Loaded image: " << width << "x" << height
-              << " with " << channels << " channels.\n";
+    // A map file (.gmap, written by map_convert), a map_server YAML or a bare image,
+    // optionally followed by a trace file that records every query for replay_trace
+    // constexpr auto default_map_path = "../data/maze-1-10x10.png";
+    constexpr auto default_map_path = "../data/maze-1-100x100.png";
+    // constexpr auto default_map_path = "../data/maze-4-500x500.png";
+    const std::string map_path = argc > 1 ? argv[1] : default_map_path;
+    std::cout << "Loading map: " << map_path << "\n";
 
+    auto has_extension = [&](const std::string& extension) {
+        return map_path.size() >= extension.size() &&
+               map_path.compare(map_path.size() - extension.size(), extension.size(), extension) == 0;
+    };
 
     /** Create ROS-style Occupancy Grid Map 
      * - int8[] data ... probability [0,100], unknown = -1
+     * - rows are stored bottom to top, so the image is flipped on load
+     * - a .gmap file is mapped in place, with no decoding
     */
-    struct MapMetaData {
-        int width;
-        int height;
-        float resolution; // meters per pixel
-        float origin_x;  // origin in meters
-        float origin_y;  // origin in meters
-    };
-    MapMetaData map_metadata {
-        .width = width,
-        .height = height,
-        .resolution = 0.1f, // 0.1 m per cell
-        .origin_x = 0.0f,   // origin at (0,0)
-        .origin_y = 0.0f    // origin at (0,0)
-    };
-    std::unique_ptr<int8_t[]> occupancy_grid = std::make_unique<int8_t[]>(width * height);
-
-    for (int i = 0; i < width * height; ++i) {
-        if (data.get()[i] == 0) {
-            occupancy_grid[i] = 100;
-        } else {
-            occupancy_grid[i] = 0;
+    gridmap::OccupancyGrid occupancy_grid;
+    gridmap::MapFile map_file;
+    if (has_extension(".gmap")) {
+        if (!gridmap::openMapFile(map_path, occupancy_grid, map_file)) {
+            std::cerr << "Failed to open map file: " << map_path << "\n";
+            return 1;
         }
+    } else {
+        if (!has_extension(".yaml")) {
+            map_file.info.image = map_path;
+        } else if (!gridmap::loadMapYaml(map_path, map_file.info)) {
+            std::cerr << "Failed to read map YAML: " << map_path << "\n";
+            return 1;
+        }
+        if (!gridmap::loadImageMap(map_file.info.image, occupancy_grid, map_file.info)) {
+            std::cerr << "Failed to load image: " << stbi_failure_reason() << "\n";
+            return 1;
+        }
+        map_file.metaData = map_file.info.metaData(occupancy_grid.width(), occupancy_grid.height());
     }
+    int width = occupancy_grid.width();
+    int height = occupancy_grid.height();
+
+    std::cout << "Loaded map: " << width << "x" << height << "\n";
+
+    const gridmap::MapMetaData map_metadata = map_file.metaData;
     
     int px_per_cell = 10;
     int grid_width = width * px_per_cell;
@@ -163,91 +174,78 @@ int main() {
     RenderModule::Console().SetCoutRedirect(true);
 
 
-    /* Create a FB and draw to it */
-    int fb_width = width*px_per_cell;
-    int fb_height = height*px_per_cell;
-    
-    // NVGLUframebuffer* fb = nvgluCreateFramebuffer(vg, width, height, NVG_IMAGE_REPEATX | NVG_IMAGE_REPEATY | NVG_IMAGE_FLIPY);
+    /* Static map layer */
+    // The map is drawn as a pyramid of nearest-sampled tiles: only tiles in
+    // view are drawn, at the level where one texel is about one screen pixel,
+    // so frame cost no longer grows with the map size.
     nvg::SetContext(RenderModule::GetNanoVGContext());
-    NVGLUframebuffer* fb = nvg::GLUtilsCreateFramebuffer(fb_width, fb_height, 
-        // NVG_IMAGE_REPEATX | NVG_IMAGE_REPEATY | 
-        // NVG_IMAGE_FLIPY
-        // NVG_IMAGE_NEAREST
-        0
-    );
-    if (!fb) {
-        std::cerr << "Failed to create framebuffer." << std::endl;
-        return -1;
-    }
-    // nvgImageSize(vg, fb->image, &width, &height);
-    NVGpaint img_paint;
-    auto render_grid_map = [&](bool offscreen = true) {
-        if (offscreen) {
-            nvg::GLUtilsBindFramebuffer(fb);
-            glad::glViewport(0, 0, fb_width, fb_height);
-            glad::glClearColor(0, 0, 0, 0);
-            glad::glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-
-            /* Draw Grid Map */
-            nvg::BeginFrame(fb_width, fb_height, 1.0f);
+    gridmap::TileRenderer map_tiles;
+    uint64_t map_layer_version = 0;
+    auto occupancy_value = [&](int x, int y) { return gridmap::occupancyLayerValue(occupancy_grid, x, y); };
+    auto rebuild_map_layer = [&]() {
+        map_tiles.setLayer(width, height, static_cast<float>(px_per_cell), gridmap::occupancyPalette(), occupancy_value);
+        map_layer_version = occupancy_grid.version();
+    };
+    rebuild_map_layer();
+
+    /* Costmap heatmap */
+    gridmap::Costmap costmap(occupancy_grid, gridmap::InflationParams(), astar::ThreadPool::shared(), map_file.clearance);
+    gridmap::TileRenderer cost_tiles;
+    bool show_costmap = false;
+    auto cost_value = [&](int x, int y) { return costmap.cellCost(x, y); };
+    cost_tiles.setLayer(width, height, static_cast<float>(px_per_cell), gridmap::costmapPalette(), cost_value);
+
+    /* Expanded-node heatmap of the last search */
+    // Cells hold the expansion order scaled to 1..255, 0 where nothing was
+    // expanded; a new result only re-rasterizes the area both searches touched.
+    gridmap::TileRenderer expansion_tiles;
+    bool show_expansions = false;
+    std::vector<uint8_t> expansion_heat(static_cast<size_t>(width) * static_cast<size_t>(height), 0);
+    gridmap::CellRect expansion_rect;
+    auto expansion_value = [&](int x, int y) { return expansion_heat[static_cast<size_t>(y) * width + x]; };
+    expansion_tiles.setLayer(width, height, static_cast<float>(px_per_cell), gridmap::expansionPalette(), expansion_value);
+    auto show_expanded_cells = [&](const std::vector<int32_t>& cells) {
+        const gridmap::CellRect cleared = expansion_rect;
+        for (int y = cleared.y0; y < cleared.y1; ++y) {
+            std::fill_n(expansion_heat.begin() + static_cast<size_t>(y) * width + cleared.x0, cleared.width(), 0);
         }
-
-            nvg::BeginPath();
-            nvg::Rect(0, 0, static_cast<float>(grid_width), static_cast<float>(grid_height));
-            nvg::FillColor(nvg::RGBAf(1.0f, 1.0f, 1.0f, 1.0f));
-            nvg::Fill();
-
-            for (int i = 0; i < width * height; ++i) {
-                int x = (i % width) * px_per_cell;
-                int y = (i / width) * px_per_cell;
-                y = grid_height - y - px_per_cell; // Invert y-axis for correct rendering
-                int8_t value = occupancy_grid.get()[i];
-                if (value == 0) {
-                    continue;
-                }
-                nvg::BeginPath();
-                nvg::Rect(static_cast<float>(x), static_cast<float>(y), static_cast<float>(px_per_cell), static_cast<float>(px_per_cell));
-                nvg::FillColor(nvg::RGBAf(0.6f, 0.6f, 0.6f, 1.0f));
-                nvg::Fill();
-            }
-
-            nvg::BeginPath();
-            // draw grid lines
-            for (int i = 0; i <= grid_width; i+=px_per_cell) {
-                nvg::MoveTo(i, 0);
-                nvg::LineTo(i, grid_height);
-            }
-            for (int i = 0; i <= grid_height; i+=px_per_cell) {
-                nvg::MoveTo(0, i);
-                nvg::LineTo(grid_width, i);
-            }
-            nvg::StrokeColor(nvg::RGBAf(0.2f, 0.2f, 0.2f, 0.6f));
-            nvg::StrokeWidth(0.8f);
-            nvg::Stroke();
-        
-        if (offscreen) {
-            nvg::EndFrame();
-            nvg::GLUtilsBindFramebuffer(nullptr); 
-                
-            // NVGpaint img_paint = nvg::ImagePattern(0, 0, fb_width, fb_height, 0, fb->image, 1.0f);
-            img_paint = nvg::ImagePattern(0, 0, fb_width, fb_height, 0, fb->image, 1.0f);
-            if (img_paint.image == 0) {
-                std::cerr << "Failed to create image pattern." << std::endl;
-                return -1;
-            }
+        expansion_rect = gridmap::CellRect();
+        const size_t last = cells.size() > 1 ? cells.size() - 1 : 1;
+        for (size_t i = 0; i < cells.size(); ++i) {
+            const int x = cells[i] % width;
+            const int y = cells[i] / width;
+            expansion_heat[cells[i]] = static_cast<uint8_t>(1 + (254 * i) / last);
+            expansion_rect = expansion_rect.united(gridmap::CellRect{x, y, x + 1, y + 1});
         }
-        return 0;
+        expansion_tiles.invalidate(cleared.united(expansion_rect), expansion_value);
+    };
+
+    /* Flow field towards the end pose */
+    // Cost to reach the end cell from every cell, scaled to 1..255 by the
+    // largest reachable cost; computed by the planner worker along with each path.
+    std::shared_ptr<const astar::FlowField> flow_field;
+    gridmap::TileRenderer flow_tiles;
+    bool show_flow_field = false;
+    auto flow_value = [&](int x, int y) -> uint8_t {
+        if (flow_field == nullptr || flow_field->maxCost() <= 0.0f) return 0;
+        const float cost = flow_field->cost(x, y);
+        if (cost == astar::FlowField::kUnreachable) return 0;
+        return static_cast<uint8_t>(1.0f + 254.0f * cost / flow_field->maxCost());
     };
-    render_grid_map();
+    flow_tiles.setLayer(width, height, static_cast<float>(px_per_cell), gridmap::flowFieldPalette(), flow_value);
+
+    /* Frame timings */
+    gridmap::TimingHistory map_timings;
+    gridmap::TimingHistory overlay_timings;
+    gridmap::TimingHistory plan_timings;
 
 
     std::random_device rd;
     std::mt19937 gen(rd());
     // std::uniform_real_distribution<float> dist(0.0f, std::static_cast<float>(fb_width));
-    std::uniform_real_distribution<float> dist(0.0f, static_cast<float>(fb_width));
+    std::uniform_real_distribution<float> dist(0.0f, static_cast<float>(grid_width));
     // std::uniform_real_distribution<float> dist(0.0f, static_cast<float>(10));
-    std::vector<float> x_coords;
-    std::vector<float> y_coords;
+    gridmap::SquareOverlay squares;
 
     float test = 0.5f;
     bool toggle = false;
@@ -277,33 +275,144 @@ int main() {
         nvg::Fill();
     };
     
+    astar::AsyncPlanner async_planner(occupancy_grid,
+        astar::PlannerIndices{map_path + ".landmarks", map_file.landmarks, map_file.clearance});
+    astar::PlanKey submitted_key;
+    astar::PlanHandle plan_handle;
+    int algorithm_index = static_cast<int>(astar::Algorithm::kAStar);
+
+    /* Path post-processing */
+    // The cell path is shortcut and splined towards the start and end pose
+    // headings; redone when a new result arrives or a heading changes.
+    astar::PathSmoother path_smoother(occupancy_grid);
+    std::vector<astar::PathPose> smoothed_path;
+    uint64_t smoothed_request = 0;
+    float smoothed_start_heading = 0.0f;
+    float smoothed_end_heading = 0.0f;
+    bool show_raw_path = false;
+
+    /* Map editing */
+    // Brush strokes change the grid cell by cell. The planner worker is
+    // stopped before the first change and not restarted until the stroke
+    // ends; only the map tiles and costmap cells under the stroke are redone.
+    gridmap::MapEditor map_editor(occupancy_grid);
+    int edit_tool = 0; // 0 navigate, 1 paint obstacles, 2 erase
+    float brush_radius = 1.5f;
+    bool brush_down = false;
+    bool stroke_open = false;
+    float brush_x = 0.0f; // Canvas coordinates of the cursor
+    float brush_y = 0.0f;
+    float stroke_x = 0.0f; // Cell coordinates of the last stroke sample
+    float stroke_y = 0.0f;
+
+    /* Query trace */
+    // Poses, finished queries and map edits, streamed to disk as they happen.
+    astar::TraceWriter trace;
+    if (argc > 2) {
+        if (trace.open(argv[2], occupancy_grid, map_path)) {
+            std::cout << "Recording queries to " << argv[2] << "\n";
+        } else {
+            std::cerr << "Failed to open trace file: " << argv[2] << "\n";
+        }
+    }
+
+    // Adopts, logs and records the newest finished plan, if any
+    auto adopt_result = [&]() {
+        if (!async_planner.pollResult()) return;
+        const astar::PlanResult& result = async_planner.latest();
+        std::cout << astar::algorithmName(result.key.algorithm) << " planned from (" << result.key.start.x << ", " << result.key.start.y << ") to ("
+                  << result.key.goal.x << ", " << result.key.goal.y << "): " << result.path.size()
+                  << " points, " << result.expanded << " expanded in " << result.milliseconds << " ms.\n";
+        plan_timings.add(static_cast<float>(result.milliseconds));
+        trace.recordQuery(result.key, !result.path.empty(), result.path.size(), result.expanded,
+                          result.milliseconds);
+        if (show_expansions) {
+            show_expanded_cells(result.expandedCells);
+        }
+    };
+    // Before the map is edited: stops the worker, and records a plan it finished so that it precedes the edit in the trace
+    auto settle_planner = [&]() {
+        async_planner.waitIdle();
+        adopt_result();
+        plan_handle = astar::PlanHandle(); // The cancelled request is never published; plan again
+    };
+
+    auto show_edits = [&]() {
+        const gridmap::CellRect dirty = map_editor.takeDirty();
+        if (dirty.empty()) return;
+        trace.recordChanges(occupancy_grid);
+        map_tiles.invalidate(dirty, occupancy_value);
+        map_layer_version = occupancy_grid.version();
+        costmap.refresh();
+        cost_tiles.invalidate(costmap.lastUpdated(), cost_value);
+    };
+    auto undo_edit = [&](bool redo) {
+        settle_planner();
+        if (redo) {
+            map_editor.redo();
+        } else {
+            map_editor.undo();
+        }
+        show_edits();
+    };
+
     auto run_a_star = [&]() {
-        std::cout << "Running A* algorithm...\n";
         astar::Point this_start(static_cast<int>(start.x / px_per_cell), static_cast<int>(start.y / px_per_cell));
         astar::Point this_end(static_cast<int>(end.x / px_per_cell), static_cast<int>(end.y / px_per_cell));
-        std::cout << "Start Point: (" << this_start.x << ", " << this_start.y << ")\n";
-        std::cout << "End Point: (" << this_end.x << ", " << this_end.y << ")\n";
-        astar::AStar a_star(map_metadata.width, map_metadata.height, this_start, this_end);
-        for (int i = 0; i < map_metadata.width*map_metadata.height; ++i) {
-            if (occupancy_grid[i] != 0) {
-                int x = i % map_metadata.width;
-                int y = i / map_metadata.width;
-                a_star.setWall(x, 99-y);
-                // std::cout << "Setting wall at (" << x << ", " << y << ")\n";
-            }
+        astar::Algorithm algorithm = static_cast<astar::Algorithm>(algorithm_index);
+        // Only the lattice plans for the pose headings; the grid searches replan on cell changes alone
+        const bool lattice = algorithm == astar::Algorithm::kLattice;
+        astar::PlanKey key{this_start, this_end, occupancy_grid.version(), algorithm,
+                           lattice ? start.theta : 0.0f, lattice ? end.theta : 0.0f};
+        if (!plan_handle.valid() || key != submitted_key) {
+            // Supersedes (and cancels) whatever the worker is still busy with
+            plan_handle = async_planner.submit(this_start, this_end, algorithm, key.startHeading, key.goalHeading);
+            submitted_key = key;
         }
-        std::vector<astar::Point> path = a_star.findPath();
-        std::cout << "A* Path found with " << path.size() << " points.\n";
+        adopt_result();
         // start.active = false;
         // end.active = false;
-        if (!path.empty()) {
+        const astar::PlanResult& latest = async_planner.latest();
+        if (show_flow_field && latest.flowField && latest.flowField != flow_field) {
+            flow_field = latest.flowField;
+            flow_tiles.invalidate(occupancy_grid.bounds(), flow_value);
+        }
+        if (latest.requestId != smoothed_request || start.theta != smoothed_start_heading || end.theta != smoothed_end_heading) {
+            // A lattice path is already drivable and is drawn as planned
+            if (!latest.poses.empty()) {
+                smoothed_path = latest.poses;
+            } else {
+                path_smoother.smooth(latest.path, start.theta, end.theta, smoothed_path);
+                if (!smoothed_path.empty()) {
+                    const astar::PathPose first = astar::toWorld(map_metadata, smoothed_path.front());
+                    const astar::PathPose last = astar::toWorld(map_metadata, smoothed_path.back());
+                    std::cout << "Smoothed to " << smoothed_path.size() << " poses via " << path_smoother.shortcutWaypoints().size()
+                              << " waypoints, (" << first.x << ", " << first.y << ") m to (" << last.x << ", " << last.y << ") m.\n";
+                }
+            }
+            smoothed_request = latest.requestId;
+            smoothed_start_heading = start.theta;
+            smoothed_end_heading = end.theta;
+        }
+        if (smoothed_path.size() > 1) {
+            nvg::BeginPath();
+            nvg::MoveTo(smoothed_path.front().x*px_per_cell, smoothed_path.front().y*px_per_cell);
+            for (const auto& pose : smoothed_path) {
+                nvg::LineTo(pose.x*px_per_cell, pose.y*px_per_cell);
+            }
+            nvg::StrokeColor(nvg::RGBAf(0.0f, 0.0f, 1.0f, 1.0f));
+            nvg::StrokeWidth(2.0f);
+            nvg::Stroke();
+        }
+        const std::vector<astar::Point>& path = latest.path;
+        if (show_raw_path && !path.empty()) {
             nvg::BeginPath();
             nvg::MoveTo(path.front().x*px_per_cell + 0.5f*px_per_cell, (path.front().y)*px_per_cell + 0.5f*px_per_cell);
             for (const auto& point : path) {
                 nvg::LineTo(point.x*px_per_cell + 0.5f*px_per_cell, point.y*px_per_cell + 0.5f*px_per_cell);
             }
-            nvg::StrokeColor(nvg::RGBAf(0.0f, 0.0f, 1.0f, 1.0f));
-            nvg::StrokeWidth(2.0f);
+            nvg::StrokeColor(nvg::RGBAf(0.0f, 0.0f, 1.0f, 0.35f));
+            nvg::StrokeWidth(1.0f);
             nvg::Stroke();
         }
     };
@@ -321,9 +430,7 @@ int main() {
         }
         if (ImGui::Button("Reset", buttonSize)) {
             square_count = 0;
-            x_coords.clear();
-            y_coords.clear();
-            render_grid_map();
+            squares.clear(); // Squares are their own overlay; the map layer is untouched
         }
         if (ImGui::Button("Start Pose", buttonSize)) {
             pose_start_interaction_state = PoseInteractionState::kAwaitingStartClick;
@@ -333,6 +440,77 @@ int main() {
             pose_end_interaction_state = PoseInteractionState::kAwaitingStartClick;
             RenderContext::Instance().disableViewportControls = true;
         }
+        const char* algorithm_names[] = {
+            astar::algorithmName(astar::Algorithm::kAStar),
+            astar::algorithmName(astar::Algorithm::kJumpPoint),
+            astar::algorithmName(astar::Algorithm::kJumpPointBitScan),
+            astar::algorithmName(astar::Algorithm::kHierarchical),
+            astar::algorithmName(astar::Algorithm::kIncremental),
+            astar::algorithmName(astar::Algorithm::kLandmarks),
+            astar::algorithmName(astar::Algorithm::kCostAware),
+            astar::algorithmName(astar::Algorithm::kLattice),
+        };
+        ImGui::Combo("Planner", &algorithm_index, algorithm_names, IM_ARRAYSIZE(algorithm_names));
+        ImGui::Checkbox("Show costmap", &show_costmap);
+        ImGui::Checkbox("Show raw path", &show_raw_path);
+        if (ImGui::Checkbox("Show flow field", &show_flow_field)) {
+            async_planner.setComputeFlowFields(show_flow_field);
+            if (show_flow_field) plan_handle = astar::PlanHandle(); // Search again to compute the field
+        }
+        ImGui::Separator();
+        bool tool_changed = ImGui::RadioButton("Navigate", &edit_tool, 0);
+        ImGui::SameLine();
+        tool_changed |= ImGui::RadioButton("Paint", &edit_tool, 1);
+        ImGui::SameLine();
+        tool_changed |= ImGui::RadioButton("Erase", &edit_tool, 2);
+        if (tool_changed) {
+            RenderContext::Instance().disableViewportControls = edit_tool != 0;
+        }
+        ImGui::SliderFloat("Brush radius", &brush_radius, 0.5f, 20.0f, "%.1f cells");
+        if (ImGui::Button("Undo", buttonSize) && map_editor.canUndo()) {
+            undo_edit(false);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Redo", buttonSize) && map_editor.canRedo()) {
+            undo_edit(true);
+        }
+        ImGui::Text("History: %zu strokes, %.1f KiB", map_editor.undoDepth(),
+                    static_cast<double>(map_editor.historyBytes()) / 1024.0);
+        ImGui::End();
+    });
+
+    auto plot_timings = [](const char* label, const gridmap::TimingHistory& history) {
+        char overlay[64];
+        std::snprintf(overlay, sizeof(overlay), "last %.2f, mean %.2f, max %.2f ms", history.last(), history.mean(), history.max());
+        ImGui::PlotHistogram(label, history.samples(), history.size(), history.offset(), overlay, 0.0f,
+                             std::max(history.max(), 1.0f), ImVec2(0, 60));
+    };
+
+    RenderModule::RegisterImGuiCallback([&]() {
+        ImGui::Begin("Profiling");
+        const astar::PlanResult& result = async_planner.latest();
+        const astar::SearchStats& stats = result.stats;
+        ImGui::Text("Last plan: %s, %zu points", astar::algorithmName(result.key.algorithm), result.path.size());
+        ImGui::Text("Expanded: %zu", stats.expanded);
+        ImGui::Text("Pushes: %zu, re-queued: %zu, stale pops: %zu", stats.pushes, stats.duplicatePushes, stats.stalePops);
+        ImGui::Text("Open list peak: %zu", stats.openPeak);
+        ImGui::Text("Allocated: %.1f KiB", static_cast<double>(stats.bytesAllocated) / 1024.0);
+        ImGui::Text("Time: %s %.3f, %s %.3f, %s %.3f ms",
+                    astar::searchPhaseName(astar::SearchPhase::kSetup), stats.phaseMilliseconds[0],
+                    astar::searchPhaseName(astar::SearchPhase::kExpand), stats.phaseMilliseconds[1],
+                    astar::searchPhaseName(astar::SearchPhase::kPath), stats.phaseMilliseconds[2]);
+        if (ImGui::Checkbox("Show expanded nodes", &show_expansions)) {
+            async_planner.setRecordExpansions(show_expansions);
+            if (show_expansions) {
+                plan_handle = astar::PlanHandle(); // Search again to record the expansions
+            } else {
+                show_expanded_cells({});
+            }
+        }
+        ImGui::Separator();
+        plot_timings("Planner", plan_timings);
+        plot_timings("Map layer", map_timings);
+        plot_timings("Overlays", overlay_timings);
         ImGui::End();
     });
 
@@ -340,6 +518,12 @@ int main() {
         ImGui::Begin("Grid Map Viewer");
         ImGui::Text("Width: %d, Height: %d, Resolution: %.2f m/pixel", map_metadata.width, map_metadata.height, map_metadata.resolution);
         ImGui::Text("Square count: %d", square_count);
+        ImGui::Text("Squares: %zu drawn in %.2f ms, %.0f primitives/s, frame %.2f ms", squares.lastDrawn(),
+                    squares.lastDrawMilliseconds(), squares.primitivesPerSec(), squares.frameMilliseconds());
+        ImGui::Text("Planner invocations: %llu%s", static_cast<unsigned long long>(async_planner.invocations()),
+                    async_planner.busy() ? " (planning...)" : "");
+        ImGui::Text("Map tiles: %zu drawn, %zu uploaded, %zu resident (level %d)", map_tiles.lastTilesDrawn(),
+                    map_tiles.lastUploads(), map_tiles.residentImages(), map_tiles.lastLevel());
         ImGui::Separator();
         ImGui::End();
     });
@@ -354,7 +538,7 @@ int main() {
                 bool pose_set = HandlePoseInteractionStateMachine(start, pose_start_interaction_state, canvasPos, canvasSize);
                 if (pose_set) {
                     pose_start_interaction_state = PoseInteractionState::kInactive;
-                    RenderContext::Instance().disableViewportControls = false;
+                    RenderContext::Instance().disableViewportControls = edit_tool != 0;
                     std::cout << "Start Pose set.\n";
                     // std::cout << "Start Pose: (" << start.x << ", " << start.y << ", " << start.theta << ")\n";
                 }
@@ -363,21 +547,53 @@ int main() {
                 bool pose_set = HandlePoseInteractionStateMachine(end, pose_end_interaction_state, canvasPos, canvasSize);
                 if (pose_set) {
                     pose_end_interaction_state = PoseInteractionState::kInactive;
-                    RenderContext::Instance().disableViewportControls = false;
+                    RenderContext::Instance().disableViewportControls = edit_tool != 0;
                     std::cout << "End Pose set.\n";
                     // std::cout << "End Pose: (" << end.x << ", " << end.y << ", " << end.theta << ")\n";
                 }
             }
 
+            /* Brush input; the pose tools take precedence */
+            brush_down = false;
+            if (edit_tool != 0 && pose_start_interaction_state == PoseInteractionState::kInactive &&
+                pose_end_interaction_state == PoseInteractionState::kInactive) {
+                ImVec2 cursorBackup = ImGui::GetCursorPos();
+                ImGui::SetCursorScreenPos(canvasPos);
+                ImGui::InvisibleButton("##MapEdit", canvasSize, ImGuiButtonFlags_MouseButtonLeft);
+                ImGui::SetCursorPos(cursorBackup);
+                brush_down = ImGui::IsItemActive() && ImGui::IsMouseDown(ImGuiMouseButton_Left);
+                const ImVec2 mousePos = ImGui::GetIO().MousePos;
+                brush_x = mousePos.x - canvasPos.x;
+                brush_y = canvasSize.y - (mousePos.y - canvasPos.y);  // Flip Y
+            }
+
             RenderModule::ZoomView([&](NVGcontext* vg) {
                 ZoomView::SetOffset(ImVec2(65, 50), ZoomView::Flags::kOnceOnly);
                 // ZoomView::SetScale(3.0f, ZoomView::Flags::kOnceOnly);
-                /* Render Pre-Computed Background */
-                // nvg::BeginPath();
-                // nvg::Rect(0, 0, fb_width, fb_height);
-                // nvg::FillPaint(img_paint);
-                // nvg::Fill();
-                render_grid_map(false);
+                /* Render visible map tiles */
+                gridmap::ViewWindow view;
+                view.x1 = canvasSize.x;
+                view.y1 = canvasSize.y;
+                ZoomView::CanvasToView(view.x0, view.y0);
+                ZoomView::CanvasToView(view.x1, view.y1);
+                float unit = 1.0f;
+                ZoomView::CanvasToView(unit);
+                view.pixelsPerUnit = 1.0f / unit;
+                {
+                    gridmap::ScopedTiming timing(map_timings);
+                    map_tiles.draw(view);
+                    map_tiles.drawGridLines(view, nvg::RGBAf(0.2f, 0.2f, 0.2f, 0.6f));
+                }
+                gridmap::ScopedTiming timing(overlay_timings);
+                if (show_costmap) {
+                    cost_tiles.draw(view);
+                }
+                if (show_expansions) {
+                    expansion_tiles.draw(view);
+                }
+                if (show_flow_field && flow_field != nullptr) {
+                    flow_tiles.draw(view);
+                }
 
                 /* Transform once from canvas to view */
                 if (start.active && !start.transformed) {
@@ -386,6 +602,7 @@ int main() {
                     ZoomView::CanvasToView(start.dy);
                     start.transformed = true;
                     std::cout << "Start Pose: (" << start.x << ", " << start.y << ", " << start.theta << ")\n";
+                    trace.recordPose(false, start.x / px_per_cell, start.y / px_per_cell, start.theta);
                 }
                 if (end.active && !end.transformed) {
                     ZoomView::CanvasToView(end.x, end.y);
@@ -393,9 +610,34 @@ int main() {
                     ZoomView::CanvasToView(end.dy);
                     end.transformed = true;
                     std::cout << "End Pose: (" << end.x << ", " << end.y << ", " << end.theta << ")\n";
+                    trace.recordPose(true, end.x / px_per_cell, end.y / px_per_cell, end.theta);
                 }
 
-                if (start.active && start.transformed && end.active && end.transformed) {
+                /* Brush strokes, in cells */
+                float brush_cell_x = brush_x;
+                float brush_cell_y = brush_y;
+                ZoomView::CanvasToView(brush_cell_x, brush_cell_y);
+                brush_cell_x /= px_per_cell;
+                brush_cell_y /= px_per_cell;
+                if (brush_down) {
+                    if (!stroke_open) {
+                        settle_planner();
+                        map_editor.beginStroke();
+                        stroke_x = brush_cell_x;
+                        stroke_y = brush_cell_y;
+                        stroke_open = true;
+                    }
+                    const int8_t value = edit_tool == 1 ? gridmap::OccupancyGrid::kOccupied : gridmap::OccupancyGrid::kFree;
+                    map_editor.paintLine(stroke_x, stroke_y, brush_cell_x, brush_cell_y, brush_radius, value);
+                    stroke_x = brush_cell_x;
+                    stroke_y = brush_cell_y;
+                    show_edits();
+                } else if (stroke_open) {
+                    map_editor.endStroke();
+                    stroke_open = false;
+                }
+
+                if (start.active && start.transformed && end.active && end.transformed && !stroke_open) {
                     run_a_star();
                 }
 
@@ -408,23 +650,28 @@ int main() {
                     // nvg::BeginFrame(fb_width, fb_height, 1.0f);
 
                     for (int i = 0; i < count; ++i) {
-                        x_coords.emplace_back(dist(gen));
-                        y_coords.emplace_back(dist(gen));
+                        float x = dist(gen);
+                        float y = dist(gen);
+                        squares.add(x, y);
                         square_count++;
                     }
                     // nvg::EndFrame();
                     // nvg::GLUtilsBindFramebuffer(nullptr);
                     step = false;
                 }
-                for (int i = 0; i < x_coords.size(); ++i) {
-                    nvg::BeginPath();
-                    nvg::Rect(x_coords[i], y_coords[i], px_per_cell*test, px_per_cell*test);
-                    nvg::FillColor(nvg::RGBAf(1.0f, 0.0f, 0.0f, 1.0f));
-                    nvg::Fill();
-                }
+                // One path and one fill for all visible squares
+                squares.draw(view, px_per_cell*test, nvg::RGBAf(1.0f, 0.0f, 0.0f, 1.0f));
 
 
 
+                if (edit_tool != 0) {
+                    nvg::BeginPath();
+                    nvg::Circle(brush_cell_x * px_per_cell, brush_cell_y * px_per_cell, brush_radius * px_per_cell);
+                    nvg::StrokeColor(edit_tool == 1 ? nvg::RGBAf(0.8f, 0.1f, 0.1f, 0.8f) : nvg::RGBAf(0.1f, 0.6f, 0.1f, 0.8f));
+                    nvg::StrokeWidth(1.5f);
+                    nvg::Stroke();
+                }
+
                 if (start.transformed) {
                     paint_pose(vg, start);
                 }
@@ -447,6 +694,12 @@ int main() {
         },
         /* Offscreen Render */
         [&](NVGcontext* vg) {
+            /* Re-read the map layer only when the grid changed */
+            if (map_layer_version != occupancy_grid.version()) {
+                rebuild_map_layer();
+                costmap.refresh();
+                cost_tiles.invalidate(costmap.lastUpdated(), cost_value);
+            }
             // RenderModule::IsolatedFrameBuffer([&](NVGcontext* vg) {
             //     if (toggle || step) {
             //         nvg::GLUtilsBindFramebuffer(fb);
@@ -474,8 +727,11 @@ int main() {
     );
 
     RenderModule::Run();
+    map_tiles.release(); // Needs the NanoVG context
+    cost_tiles.release();
+    expansion_tiles.release();
+    flow_tiles.release();
     RenderModule::Shutdown(); 
-    // nvgluDeleteFramebuffer(fb);
 
 
     return 0;
@@ -0,0 +1,118 @@
+/** Converts a map_server map (YAML + image) into a binary map file.
+ *
+ * A .gmap file holds the occupancy and passability layers and, unless
+ * disabled with 0, the clearance field and the ALT landmark tables, so the
+ * viewer and the planners start without decoding or preprocessing anything.
+ * A .gtiles file holds the map cut into tiles for a TileStore, which streams
+ * maps too large to keep in memory; the input may also be a .gmap then.
+ *
+ * Usage: map_convert <map.yaml | image | map.gmap> <out.gmap | out.gtiles> [landmarks | tile_size] [clearance_radius]
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "costmap.hpp"
+#include "grid_planner.hpp"
+#include "landmarks.hpp"
+#include "map_file.hpp"
+#include "map_info.hpp"
+#include "map_loader.hpp"
+#include "occupancy_grid.hpp"
+#include "tile_store.hpp"
+
+namespace {
+
+bool hasExtension(const std::string &path, const std::string &extension) {
+  return path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point begin) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " <map.yaml | image | map.gmap> <out.gmap | out.gtiles> [landmarks | tile_size] [clearance_radius]\n";
+    return 2;
+  }
+  const std::string input = argv[1];
+  const std::string output = argv[2];
+  const int landmarkCount = argc > 3 ? std::atoi(argv[3]) : static_cast<int>(astar::GridPlanner::kLandmarkCount);
+  const float clearanceRadius = argc > 4 ? static_cast<float>(std::atof(argv[4])) : 16.0f;
+
+  gridmap::MapInfo info;
+  gridmap::OccupancyGrid grid;
+  auto begin = std::chrono::steady_clock::now();
+  if (hasExtension(input, ".gmap")) {
+    gridmap::MapFile contents;
+    if (!gridmap::openMapFile(input, grid, contents)) {
+      std::cerr << "Cannot open map file " << input << "\n";
+      return 1;
+    }
+    info = contents.info;
+  } else {
+    if (!hasExtension(input, ".yaml")) {
+      info.image = input;
+    } else if (!gridmap::loadMapYaml(input, info)) {
+      std::cerr << "Cannot read map YAML " << input << "\n";
+      return 1;
+    }
+    if (!gridmap::loadImageMap(info.image, grid, info)) {
+      std::cerr << "Cannot load " << info.image << ": " << stbi_failure_reason() << "\n";
+      return 1;
+    }
+  }
+  std::cerr << input << ": " << grid.width() << "x" << grid.height() << ", loaded in "
+            << millisecondsSince(begin) << " ms\n";
+
+  if (hasExtension(output, ".gtiles")) {
+    const int tileSize = argc > 3 ? std::atoi(argv[3]) : 256;
+    begin = std::chrono::steady_clock::now();
+    if (!gridmap::saveTiledMap(output, grid, info, tileSize)) {
+      std::cerr << "Cannot write " << output << "\n";
+      return 1;
+    }
+    std::cerr << output << ": " << tileSize << " cell tiles written in " << millisecondsSince(begin) << " ms\n";
+    return 0;
+  }
+
+  std::unique_ptr<gridmap::Costmap> clearance;
+  if (clearanceRadius > 0.0f) {
+    begin = std::chrono::steady_clock::now();
+    gridmap::InflationParams params;
+    params.inflationRadius = clearanceRadius;
+    clearance = std::make_unique<gridmap::Costmap>(grid, params);
+    std::cerr << "clearance up to " << clearance->clearanceCap() << " cells in " << millisecondsSince(begin) << " ms\n";
+  }
+
+  astar::LandmarkTable landmarks;
+  if (landmarkCount > 0) {
+    begin = std::chrono::steady_clock::now();
+    landmarks = astar::buildLandmarkTable(grid, static_cast<size_t>(landmarkCount));
+    std::cerr << landmarks.landmarks.size() << " landmarks in " << millisecondsSince(begin) << " ms\n";
+  }
+
+  if (!gridmap::saveMapFile(output, grid, info, clearance.get(), landmarkCount > 0 ? &landmarks : nullptr)) {
+    std::cerr << "Cannot write " << output << "\n";
+    return 1;
+  }
+
+  begin = std::chrono::steady_clock::now();
+  gridmap::OccupancyGrid mapped;
+  gridmap::MapFile contents;
+  if (!gridmap::openMapFile(output, mapped, contents)) {
+    std::cerr << "Cannot read back " << output << "\n";
+    return 1;
+  }
+  std::cerr << output << ": opened in " << millisecondsSince(begin) << " ms\n";
+  return 0;
+}
@@ -0,0 +1,296 @@
+/** Replays a query trace recorded by the viewer against this build's planners.
+ *
+ * The trace is streamed one record at a time, so traces of millions of
+ * queries replay in constant memory. Map edits are applied to the grid as
+ * they were recorded and every query is run again with the algorithm it was
+ * recorded with, on one GridPlanner, timed the same way AsyncPlanner times
+ * it. The map is the one named in the trace unless another, non-empty path
+ * is given; its passability must match the recorded hash.
+ *
+ * Latencies are summarized in log-spaced histograms (buckets about 2.3%
+ * wide), so the reported percentiles are approximate. Results go to stdout
+ * as JSON: recorded and replayed latency per algorithm, queries whose
+ * outcome changed, and the largest regressions. With a CSV path every query
+ * is also written there with both latencies. Progress goes to stderr.
+ *
+ * Usage: replay_trace <trace.gqtr> [map.gmap | map.yaml | image] [diffs.csv]
+ */
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "grid_planner.hpp"
+#include "map_file.hpp"
+#include "map_info.hpp"
+#include "map_loader.hpp"
+#include "occupancy_grid.hpp"
+#include "query_trace.hpp"
+#include "search_workspace.hpp"
+
+namespace {
+
+constexpr size_t kAlgorithmCount = static_cast<size_t>(astar::Algorithm::kLattice) + 1;
+constexpr size_t kTopRegressions = 10;
+
+bool hasExtension(const std::string &path, const std::string &extension) {
+  return path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point begin) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+std::string jsonString(const std::string &s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out + "\"";
+}
+
+/// Latencies from 0.1 us to 100 s in log-spaced buckets, 100 per decade.
+class LatencyHistogram {
+public:
+  void add(double milliseconds) {
+    ++total;
+    sum += milliseconds;
+    const double position = std::log10(std::max(milliseconds, kLowest) / kLowest) * kPerDecade;
+    ++buckets[std::min(buckets.size() - 1, static_cast<size_t>(position))];
+  }
+
+  size_t count() const { return total; }
+  double mean() const { return total > 0 ? sum / static_cast<double>(total) : 0.0; }
+
+  /// The geometric middle of the bucket holding the p-th fraction of the samples.
+  double percentile(double p) const {
+    if (total == 0) return 0.0;
+    const size_t rank = static_cast<size_t>(p * static_cast<double>(total - 1) + 0.5);
+    size_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+      seen += buckets[i];
+      if (seen > rank) return kLowest * std::pow(10.0, (static_cast<double>(i) + 0.5) / kPerDecade);
+    }
+    return kLowest * std::pow(10.0, static_cast<double>(buckets.size()) / kPerDecade);
+  }
+
+private:
+  static constexpr double kLowest = 1e-4;
+  static constexpr double kPerDecade = 100.0;
+
+  std::array<size_t, 900> buckets{};
+  size_t total = 0;
+  double sum = 0.0;
+};
+
+struct Regression {
+  size_t query;
+  astar::TraceQuery recorded;
+  double replayedMs;
+
+  double diff() const { return replayedMs - recorded.milliseconds; }
+  bool operator>(const Regression &o) const { return diff() > o.diff(); }
+};
+
+struct AlgorithmSummary {
+  LatencyHistogram recorded;
+  LatencyHistogram replayed;
+  size_t faster = 0;
+  size_t slower = 0; // Replayed more than 10% and 0.01 ms slower
+};
+
+void printLatency(const char *name, const LatencyHistogram &histogram) {
+  std::cout << "\"" << name << "\": {\"mean_ms\": " << histogram.mean() << ", \"p50_ms\": " << histogram.percentile(0.50)
+            << ", \"p99_ms\": " << histogram.percentile(0.99) << "}";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <trace.gqtr> [map.gmap | map.yaml | image] [diffs.csv]\n";
+    return 2;
+  }
+  const std::string tracePath = argv[1];
+  astar::TraceReader trace;
+  if (!trace.open(tracePath)) {
+    std::cerr << "Cannot read trace " << tracePath << "\n";
+    return 1;
+  }
+  const std::string mapPath = argc > 2 && argv[2][0] != '\0' ? argv[2] : trace.mapPath();
+
+  gridmap::MapInfo info;
+  gridmap::OccupancyGrid grid;
+  gridmap::MapFile contents;
+  auto begin = std::chrono::steady_clock::now();
+  if (hasExtension(mapPath, ".gmap")) {
+    if (!gridmap::openMapFile(mapPath, grid, contents)) {
+      std::cerr << "Cannot open map file " << mapPath << "\n";
+      return 1;
+    }
+  } else {
+    if (!hasExtension(mapPath, ".yaml")) {
+      info.image = mapPath;
+    } else if (!gridmap::loadMapYaml(mapPath, info)) {
+      std::cerr << "Cannot read map YAML " << mapPath << "\n";
+      return 1;
+    }
+    if (!gridmap::loadImageMap(info.image, grid, info)) {
+      std::cerr << "Cannot load " << info.image << ": " << stbi_failure_reason() << "\n";
+      return 1;
+    }
+  }
+  if (grid.width() != trace.width() || grid.height() != trace.height() ||
+      gridmap::passabilityHash(grid) != trace.mapHash()) {
+    std::cerr << mapPath << " is not the map " << tracePath << " was recorded on\n";
+    return 1;
+  }
+  std::cerr << mapPath << ": " << grid.width() << "x" << grid.height() << ", loaded in " << millisecondsSince(begin)
+            << " ms\n";
+
+  std::ofstream csv;
+  if (argc > 3) {
+    csv.open(argv[3]);
+    if (!csv) {
+      std::cerr << "Cannot write " << argv[3] << "\n";
+      return 1;
+    }
+    csv << "query,algorithm,start_x,start_y,goal_x,goal_y,recorded_found,replayed_found,recorded_length,"
+           "replayed_length,recorded_ms,replayed_ms,diff_ms\n";
+  }
+
+  astar::GridPlanner planner(grid, astar::PlannerIndices{mapPath + ".landmarks", contents.landmarks, contents.clearance});
+  astar::SearchWorkspace workspace;
+  std::vector<astar::Point> path;
+  std::vector<astar::PathPose> latticePoses;
+  astar::NoSearchHooks hooks;
+  std::array<AlgorithmSummary, kAlgorithmCount> summaries;
+  std::priority_queue<Regression, std::vector<Regression>, std::greater<Regression>> regressions;
+  astar::TraceEvent event;
+  uint64_t recordedVersion = trace.mapVersion(); // The recording's version of the map as replayed so far
+  size_t queries = 0;
+  size_t poses = 0;
+  size_t edits = 0;
+  size_t changedCells = 0;
+  size_t foundMismatches = 0;
+  size_t lengthMismatches = 0;
+  size_t staleQueries = 0;
+  size_t skipped = 0;
+
+  begin = std::chrono::steady_clock::now();
+  while (trace.next(event)) {
+    switch (event.kind) {
+      case astar::TraceRecordKind::kPose:
+        ++poses;
+        break;
+      case astar::TraceRecordKind::kCells:
+        for (const astar::TraceCell &cell : event.changedCells) {
+          if (cell.index < 0 || static_cast<size_t>(cell.index) >= grid.cellCount()) continue;
+          grid.setValue(cell.index % grid.width(), cell.index / grid.width(), static_cast<int8_t>(cell.value));
+        }
+        recordedVersion = event.cells.mapVersion;
+        changedCells += event.changedCells.size();
+        ++edits;
+        break;
+      case astar::TraceRecordKind::kMap:
+        for (int y = 0; y < grid.height(); ++y) {
+          for (int x = 0; x < grid.width(); ++x) {
+            const int8_t value = event.map[grid.index(x, y)];
+            if (grid.value(x, y) != value) grid.setValue(x, y, value);
+          }
+        }
+        recordedVersion = event.cells.mapVersion;
+        changedCells += event.map.size();
+        ++edits;
+        break;
+      case astar::TraceRecordKind::kQuery: {
+        const astar::TraceQuery &query = event.query;
+        if (query.algorithm >= kAlgorithmCount) {
+          ++skipped;
+          break;
+        }
+        // Planned on another map than the one replayed. The viewer records a finished query before the
+        // edit that follows it, so this only happens with writers that do not; its outcome is not compared
+        const bool stale = query.mapVersion != recordedVersion;
+        if (stale) ++staleQueries;
+        const astar::PlanKey key = query.key();
+        const auto start = std::chrono::steady_clock::now();
+        const bool found = planner.findPath(key.algorithm, key.start, key.startHeading, key.goal, key.goalHeading,
+                                            workspace, path, latticePoses, hooks);
+        const double replayedMs = millisecondsSince(start);
+
+        AlgorithmSummary &summary = summaries[query.algorithm];
+        summary.recorded.add(query.milliseconds);
+        summary.replayed.add(replayedMs);
+        if (replayedMs > query.milliseconds * 1.1 && replayedMs > query.milliseconds + 0.01) ++summary.slower;
+        if (replayedMs * 1.1 < query.milliseconds && replayedMs + 0.01 < query.milliseconds) ++summary.faster;
+        if (!stale && found != (query.found != 0)) ++foundMismatches;
+        if (!stale && found && query.found != 0 && path.size() != query.pathLength) ++lengthMismatches;
+
+        const Regression regression{queries, query, replayedMs};
+        if (regressions.size() < kTopRegressions) {
+          regressions.push(regression);
+        } else if (regression > regressions.top()) {
+          regressions.pop();
+          regressions.push(regression);
+        }
+        if (csv.is_open()) {
+          csv << queries << ',' << jsonString(astar::algorithmName(key.algorithm)) << ',' << query.startX << ','
+              << query.startY << ',' << query.goalX << ',' << query.goalY << ',' << query.found << ',' << found << ','
+              << query.pathLength << ',' << (found ? path.size() : 0) << ',' << query.milliseconds << ',' << replayedMs
+              << ',' << replayedMs - query.milliseconds << '\n';
+        }
+        if (++queries % 10000 == 0) std::cerr << queries << " queries replayed\n";
+        break;
+      }
+    }
+  }
+  if (trace.truncated()) std::cerr << tracePath << " ends in a damaged record, replayed up to it\n";
+  std::cerr << queries << " queries and " << edits << " edits replayed in " << millisecondsSince(begin) << " ms\n";
+
+  std::cout << "{\n  \"trace\": " << jsonString(tracePath) << ",\n  \"map\": " << jsonString(mapPath)
+            << ",\n  \"queries\": " << queries << ",\n  \"poses\": " << poses << ",\n  \"edits\": " << edits
+            << ",\n  \"changed_cells\": " << changedCells << ",\n  \"truncated\": " << (trace.truncated() ? "true" : "false")
+            << ",\n  \"skipped_queries\": " << skipped << ",\n  \"stale_queries\": " << staleQueries
+            << ",\n  \"found_mismatches\": " << foundMismatches << ",\n  \"length_mismatches\": " << lengthMismatches
+            << ",\n  \"algorithms\": [";
+  bool firstAlgorithm = true;
+  for (size_t a = 0; a < kAlgorithmCount; ++a) {
+    const AlgorithmSummary &summary = summaries[a];
+    if (summary.recorded.count() == 0) continue;
+    std::cout << (firstAlgorithm ? "\n" : ",\n") << "    {\"algorithm\": "
+              << jsonString(astar::algorithmName(static_cast<astar::Algorithm>(a)))
+              << ", \"queries\": " << summary.recorded.count() << ", ";
+    printLatency("recorded", summary.recorded);
+    std::cout << ", ";
+    printLatency("replayed", summary.replayed);
+    std::cout << ", \"slower\": " << summary.slower << ", \"faster\": " << summary.faster << "}";
+    firstAlgorithm = false;
+  }
+  std::cout << "\n  ],\n  \"largest_regressions\": [";
+
+  std::vector<Regression> largest;
+  for (; !regressions.empty(); regressions.pop()) largest.push_back(regressions.top());
+  std::reverse(largest.begin(), largest.end());
+  for (size_t i = 0; i < largest.size(); ++i) {
+    const Regression &r = largest[i];
+    std::cout << (i == 0 ? "\n" : ",\n") << "    {\"query\": " << r.query << ", \"algorithm\": "
+              << jsonString(astar::algorithmName(static_cast<astar::Algorithm>(r.recorded.algorithm)))
+              << ", \"start\": [" << r.recorded.startX << ", " << r.recorded.startY << "], \"goal\": ["
+              << r.recorded.goalX << ", " << r.recorded.goalY << "], \"recorded_ms\": " << r.recorded.milliseconds
+              << ", \"replayed_ms\": " << r.replayedMs << ", \"diff_ms\": " << r.diff() << "}";
+  }
+  std::cout << "\n  ]\n}\n";
+  return 0;
+}